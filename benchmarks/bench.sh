@@ -0,0 +1,58 @@
+#!/bin/sh
+#
+# Run bfld on synthetic links of several sizes and record phase timings.
+# Usage: bench.sh BFLD GENERATOR RESULTS_DIR
+#
+# Inputs are generated once per size and reused on later runs, as long
+# as the generator options are unchanged. Every run writes a JSON time 
+# report to RESULTS_DIR/<size>-<run>.json.
+#
+# To compare linker options on the same inputs, set data to the name of
+# an earlier size and link_flags to the extra options before calling bench.
+set -e
+
+if [ $# -ne 3 ]; then
+    echo "Usage: $0 BFLD GENERATOR RESULTS_DIR" >&2
+    exit 1
+fi
+
+BFLD=$1
+GENERATOR=$2
+RESULTS=$3
+RUNS=${BENCH_RUNS:-3}
+
+mkdir -p "$RESULTS"
+
+data=
+link_flags=
+
+bench() {
+    name=$1
+    shift
+    dir="$RESULTS/${data:-$name}"
+
+    if [ ! -f "$dir/inputs" ] || [ "$(cat "$dir/options" 2>/dev/null)" != "$*" ]; then
+        rm -rf "$dir"
+        "$GENERATOR" "$@" "$dir"
+        echo "$*" > "$dir/options"
+    fi
+
+    run=1
+    while [ $run -le "$RUNS" ]; do
+        report="$RESULTS/$name-$run.json"
+        (cd "$dir" && "$BFLD" -e main --time-report=json $link_flags $(cat inputs)) > "$report"
+        wall=$(sed -n 's/.*"total": {"wall_ns": \([0-9]*\).*/\1/p' "$report")
+        printf "%-16s run %d: %8.1f ms\n" "$name" "$run" "$(echo "$wall" | awk '{print $1 / 1e6}')"
+        run=$((run + 1))
+    done
+}
+
+bench small         --objects 100 --functions 50
+bench medium        --objects 1000 --functions 100
+bench medium-noidx  --objects 1000 --functions 100 --no-index
+bench medium-debug  --objects 1000 --functions 100 --debug 4096
+bench large         --objects 5000 --functions 100 --comdat 30
+
+# Single-threaded link of the large inputs, to compare parallel phases (dce-mark)
+data=large link_flags=--threads=1
+bench large-serial  --objects 5000 --functions 100 --comdat 30
@@ -0,0 +1,809 @@
+/*
+ * Synthetic link generator.
+ *
+ * Writes ELF64 x86-64 relocatable object files and GNU style static
+ * archives that look like the output of a large C++ build with
+ * -ffunction-sections: every function has a section of its own and
+ * a relocation section with calls to other functions, inline functions
+ * are duplicated across object files in COMDAT groups, and symbol names
+ * are long and mangled.
+ *
+ * The output is deterministic for a given set of options and seed.
+ * The input files are listed in link order in a file named "inputs".
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <getopt.h>
+#include <elf.h>
+#include <sys/stat.h>
+
+
+struct gen_options
+{
+    uint32_t nobjects;      // number of object files
+    uint32_t nfunctions;    // number of functions defined in every object file
+    uint32_t name_length;   // mean symbol name length
+    uint32_t comdat;        // percentage of functions that are inline functions in COMDAT groups
+    uint32_t relocs;        // number of calls in every function
+    uint32_t dead;          // percentage of functions that are never called
+    uint32_t members;       // number of object files in every archive
+    uint32_t loose;         // number of object files given directly to the linker
+    uint32_t debug;         // size of debug section in every object file
+    bool index;             // write symbol index in archives
+    uint64_t seed;          // random seed
+};
+
+
+/*
+ * Growable byte buffer.
+ */
+struct buffer
+{
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+};
+
+
+/*
+ * Function symbol. Regular functions are defined once,
+ * inline functions are defined by many object files.
+ */
+struct function
+{
+    char *name;
+    bool is_inline;
+};
+
+
+/*
+ * Generator state.
+ */
+struct generator
+{
+    struct gen_options opts;
+    uint64_t rng;
+    struct function *functions;     // regular functions followed by inline functions
+    uint64_t nregular;              // number of regular functions
+    uint64_t ninline;               // number of inline functions
+    uint32_t *symidx;               // symbol index of a function in the current object file
+    uint32_t *stamp;                // object file that symidx is valid for (+1)
+};
+
+
+static uint64_t random_next(struct generator *gen)
+{
+    // xorshift64*
+    gen->rng ^= gen->rng >> 12;
+    gen->rng ^= gen->rng << 25;
+    gen->rng ^= gen->rng >> 27;
+    return gen->rng * 0x2545f4914f6cdd1dULL;
+}
+
+
+static uint64_t random_below(struct generator *gen, uint64_t n)
+{
+    return n > 0 ? random_next(gen) % n : 0;
+}
+
+
+static void buffer_reserve(struct buffer *buf, size_t size)
+{
+    if (buf->capacity - buf->size >= size) {
+        return;
+    }
+
+    size_t capacity = buf->capacity > 0 ? buf->capacity : 4096;
+    while (capacity - buf->size < size) {
+        capacity *= 2;
+    }
+
+    buf->data = realloc(buf->data, capacity);
+    if (buf->data == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(2);
+    }
+    buf->capacity = capacity;
+}
+
+
+static size_t buffer_append(struct buffer *buf, const void *data, size_t size)
+{
+    size_t offset = buf->size;
+
+    buffer_reserve(buf, size);
+    if (data != NULL) {
+        memcpy(buf->data + offset, data, size);
+    } else {
+        memset(buf->data + offset, 0, size);
+    }
+    buf->size += size;
+    return offset;
+}
+
+
+static size_t buffer_string(struct buffer *buf, const char *s)
+{
+    return buffer_append(buf, s, strlen(s) + 1);
+}
+
+
+static void buffer_align(struct buffer *buf, size_t align, uint8_t fill)
+{
+    while (buf->size % align != 0) {
+        buffer_append(buf, &fill, 1);
+    }
+}
+
+
+static void buffer_clear(struct buffer *buf)
+{
+    free(buf->data);
+    buf->data = NULL;
+    buf->size = 0;
+    buf->capacity = 0;
+}
+
+
+static void append_identifier(struct generator *gen, struct buffer *buf, uint32_t length)
+{
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    char component[16];
+
+    if (length == 0) {
+        length = 1;
+    }
+
+    snprintf(component, sizeof(component), "%u", length);
+    buffer_append(buf, component, strlen(component));
+
+    for (uint32_t i = 0; i < length; ++i) {
+        // Identifiers must not start with a digit
+        uint64_t n = i == 0 ? sizeof(chars) - 11 : sizeof(chars) - 1;
+        buffer_append(buf, &chars[random_below(gen, n)], 1);
+    }
+}
+
+
+/*
+ * Make a symbol name. Most names are Itanium mangled C++ names with
+ * a few nested names and parameters, the rest are plain C names.
+ * The unique part makes sure that names never collide.
+ */
+static char * make_name(struct generator *gen, const char *unique)
+{
+    static const char *params[] = {"v", "i", "j", "m", "Ri", "PKc", "RKS_", "S0_", "PS1_", "RKSt6vectorIiSaIiEE"};
+    struct buffer buf = {0};
+    uint32_t length = gen->opts.name_length;
+
+    if (random_below(gen, 5) == 0) {
+        buffer_append(&buf, unique, strlen(unique));
+        buffer_append(&buf, "_", 1);
+        uint32_t n = random_below(gen, length);
+        for (uint32_t i = 0; i < n; ++i) {
+            buffer_append(&buf, &"abcdefghijklmnopqrstuvwxyz_"[random_below(gen, 27)], 1);
+        }
+    } else {
+        uint32_t ncomponents = 2 + random_below(gen, 4);
+        uint32_t mean = length > 12 ? (length - 12) / ncomponents : 1;
+
+        buffer_append(&buf, "_ZN", 3);
+        for (uint32_t i = 0; i < ncomponents; ++i) {
+            append_identifier(gen, &buf, 1 + random_below(gen, 2 * mean));
+        }
+
+        char component[32];
+        snprintf(component, sizeof(component), "%zu%s", strlen(unique), unique);
+        buffer_append(&buf, component, strlen(component));
+        buffer_append(&buf, "E", 1);
+
+        uint32_t nparams = 1 + random_below(gen, 3);
+        for (uint32_t i = 0; i < nparams; ++i) {
+            const char *param = params[random_below(gen, sizeof(params) / sizeof(params[0]))];
+            buffer_append(&buf, param, strlen(param));
+        }
+    }
+
+    buffer_append(&buf, "", 1);
+    return (char*) buf.data;
+}
+
+
+static void make_functions(struct generator *gen)
+{
+    const struct gen_options *opts = &gen->opts;
+    uint32_t ninline_per_object = (uint64_t) opts->nfunctions * opts->comdat / 100;
+    uint32_t nregular_per_object = opts->nfunctions - ninline_per_object;
+    char unique[32];
+
+    gen->nregular = (uint64_t) opts->nobjects * nregular_per_object;
+
+    // Every inline function is defined by four object files on average
+    gen->ninline = (uint64_t) opts->nobjects * ninline_per_object / 4;
+    if (ninline_per_object > 0 && gen->ninline == 0) {
+        gen->ninline = 1;
+    }
+
+    uint64_t total = gen->nregular + gen->ninline;
+    gen->functions = calloc(total, sizeof(struct function));
+    gen->symidx = calloc(total, sizeof(uint32_t));
+    gen->stamp = calloc(total, sizeof(uint32_t));
+    if (gen->functions == NULL || gen->symidx == NULL || gen->stamp == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(2);
+    }
+
+    for (uint64_t i = 0; i < gen->nregular; ++i) {
+        if (i == 0) {
+            gen->functions[i].name = strdup("main");
+        } else {
+            snprintf(unique, sizeof(unique), "f%llu", (unsigned long long) i);
+            gen->functions[i].name = make_name(gen, unique);
+        }
+    }
+
+    for (uint64_t i = 0; i < gen->ninline; ++i) {
+        snprintf(unique, sizeof(unique), "c%llu", (unsigned long long) i);
+        gen->functions[gen->nregular + i].name = make_name(gen, unique);
+        gen->functions[gen->nregular + i].is_inline = true;
+    }
+}
+
+
+/*
+ * Pick a function to call. Functions in the dead part of every
+ * object file are never called, so that there is something for
+ * dead code elimination to remove.
+ */
+static uint64_t pick_callee(struct generator *gen)
+{
+    const struct gen_options *opts = &gen->opts;
+    uint64_t nregular_per_object = opts->nobjects > 0 ? gen->nregular / opts->nobjects : 0;
+    uint64_t nlive = nregular_per_object - nregular_per_object * opts->dead / 100;
+
+    if (gen->ninline > 0 && random_below(gen, 100) < opts->comdat) {
+        return gen->nregular + random_below(gen, gen->ninline);
+    }
+
+    if (nlive == 0) {
+        return 0;
+    }
+
+    uint64_t object = random_below(gen, opts->nobjects);
+    return object * nregular_per_object + random_below(gen, nlive);
+}
+
+
+static Elf64_Shdr * add_section(struct buffer *shdrs, struct buffer *shstrtab, const char *name,
+                                uint32_t type, uint64_t flags)
+{
+    Elf64_Shdr sh = {
+        .sh_name = buffer_string(shstrtab, name),
+        .sh_type = type,
+        .sh_flags = flags,
+        .sh_addralign = 1
+    };
+
+    size_t offset = buffer_append(shdrs, &sh, sizeof(sh));
+    return (Elf64_Shdr*) (shdrs->data + offset);
+}
+
+
+static uint32_t section_count(const struct buffer *shdrs)
+{
+    return shdrs->size / sizeof(Elf64_Shdr);
+}
+
+
+/*
+ * Build an object file in memory.
+ */
+static void make_object(struct generator *gen, uint32_t object, struct buffer *out)
+{
+    const struct gen_options *opts = &gen->opts;
+    uint64_t nregular_per_object = gen->nregular / opts->nobjects;
+    uint32_t ninline_per_object = opts->nfunctions - nregular_per_object;
+
+    // Defined functions, regular functions first
+    uint64_t ndefined = nregular_per_object + ninline_per_object;
+    uint64_t *defined = malloc(sizeof(uint64_t) * (ndefined + 1));
+    uint64_t *callees = malloc(sizeof(uint64_t) * (ndefined * opts->relocs + 1));
+
+    for (uint64_t i = 0; i < nregular_per_object; ++i) {
+        defined[i] = object * nregular_per_object + i;
+    }
+
+    // Spread the inline functions over the object files, so that every
+    // inline function is defined by at least one object file
+    ndefined = nregular_per_object;
+    for (uint32_t i = 0; i < ninline_per_object; ++i) {
+        uint64_t func = gen->nregular + ((uint64_t) object * ninline_per_object + i) % gen->ninline;
+        bool duplicate = false;
+
+        // The same inline function can only be defined once in a file
+        for (uint64_t j = nregular_per_object; j < ndefined; ++j) {
+            duplicate = duplicate || defined[j] == func;
+        }
+
+        if (!duplicate) {
+            defined[ndefined++] = func;
+        }
+    }
+
+    for (uint64_t i = 0; i < ndefined * opts->relocs; ++i) {
+        callees[i] = pick_callee(gen);
+    }
+
+    // Symbol table: defined functions first, then undefined functions
+    struct buffer symtab = {0};
+    struct buffer strtab = {0};
+    uint32_t stamp = object + 1;
+
+    buffer_append(&symtab, NULL, sizeof(Elf64_Sym));
+    buffer_append(&strtab, "", 1);
+
+    for (uint64_t i = 0; i < ndefined; ++i) {
+        gen->stamp[defined[i]] = stamp;
+        gen->symidx[defined[i]] = i + 1;
+        buffer_append(&symtab, NULL, sizeof(Elf64_Sym));
+    }
+
+    for (uint64_t i = 0; i < ndefined * opts->relocs; ++i) {
+        uint64_t callee = callees[i];
+
+        if (gen->stamp[callee] != stamp) {
+            Elf64_Sym sym = {
+                .st_name = buffer_string(&strtab, gen->functions[callee].name),
+                .st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE),
+                .st_shndx = SHN_UNDEF
+            };
+
+            gen->stamp[callee] = stamp;
+            gen->symidx[callee] = symtab.size / sizeof(Elf64_Sym);
+            buffer_append(&symtab, &sym, sizeof(sym));
+        }
+    }
+
+    uint32_t symtab_idx = 0;
+
+    // Lay out sections, section contents are appended to the file after the header
+    struct buffer shdrs = {0};
+    struct buffer shstrtab = {0};
+    char name[4096];
+
+    buffer_append(out, NULL, sizeof(Elf64_Ehdr));
+    buffer_append(&shdrs, NULL, sizeof(Elf64_Shdr));
+    buffer_append(&shstrtab, "", 1);
+
+    // Symbol table index is needed by group and relocation sections,
+    // count the sections in advance
+    uint32_t nsections = 1;
+    for (uint64_t i = 0; i < ndefined; ++i) {
+        nsections += 1 + (opts->relocs > 0) + gen->functions[defined[i]].is_inline;
+    }
+    nsections += opts->debug > 0;
+    symtab_idx = nsections;
+
+    for (uint64_t i = 0; i < ndefined; ++i) {
+        const struct function *func = &gen->functions[defined[i]];
+        uint64_t group_flag = func->is_inline ? SHF_GROUP : 0;
+        uint32_t text_idx = section_count(&shdrs) + func->is_inline;
+        uint32_t size = opts->relocs * 5 + 1;
+
+        if (func->is_inline) {
+            uint32_t entries[3] = {GRP_COMDAT, text_idx, text_idx + 1};
+            uint32_t nentries = opts->relocs > 0 ? 3 : 2;
+
+            buffer_align(out, 4, 0);
+            size_t offset = buffer_append(out, entries, sizeof(uint32_t) * nentries);
+
+            Elf64_Shdr *sh = add_section(&shdrs, &shstrtab, ".group", SHT_GROUP, 0);
+            sh->sh_offset = offset;
+            sh->sh_size = sizeof(uint32_t) * nentries;
+            sh->sh_link = symtab_idx;
+            sh->sh_info = i + 1;
+            sh->sh_entsize = sizeof(uint32_t);
+            sh->sh_addralign = 4;
+        }
+
+        // Function body is a sequence of calls followed by a return
+        buffer_align(out, 16, 0xcc);
+        size_t offset = out->size;
+        for (uint32_t j = 0; j < opts->relocs; ++j) {
+            static const uint8_t call[5] = {0xe8, 0, 0, 0, 0};
+            buffer_append(out, call, sizeof(call));
+        }
+        buffer_append(out, "\xc3", 1);
+
+        snprintf(name, sizeof(name), ".text.%s", func->name);
+        Elf64_Shdr *sh = add_section(&shdrs, &shstrtab, name, SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR | group_flag);
+        sh->sh_offset = offset;
+        sh->sh_size = size;
+        sh->sh_addralign = 16;
+
+        Elf64_Sym *sym = ((Elf64_Sym*) symtab.data) + i + 1;
+        sym->st_name = buffer_string(&strtab, func->name);
+        sym->st_info = ELF64_ST_INFO(func->is_inline ? STB_WEAK : STB_GLOBAL, STT_FUNC);
+        sym->st_shndx = text_idx;
+        sym->st_size = size;
+
+        if (opts->relocs > 0) {
+            buffer_align(out, 8, 0);
+            offset = out->size;
+
+            for (uint32_t j = 0; j < opts->relocs; ++j) {
+                uint64_t callee = callees[i * opts->relocs + j];
+                Elf64_Rela rela = {
+                    .r_offset = j * 5 + 1,
+                    .r_info = ELF64_R_INFO(gen->symidx[callee], R_X86_64_PLT32),
+                    .r_addend = -4
+                };
+                buffer_append(out, &rela, sizeof(rela));
+            }
+
+            snprintf(name, sizeof(name), ".rela.text.%s", func->name);
+            sh = add_section(&shdrs, &shstrtab, name, SHT_RELA, SHF_INFO_LINK | group_flag);
+            sh->sh_offset = offset;
+            sh->sh_size = sizeof(Elf64_Rela) * opts->relocs;
+            sh->sh_link = symtab_idx;
+            sh->sh_info = text_idx;
+            sh->sh_entsize = sizeof(Elf64_Rela);
+            sh->sh_addralign = 8;
+        }
+    }
+
+    if (opts->debug > 0) {
+        size_t offset = buffer_append(out, NULL, opts->debug);
+        Elf64_Shdr *sh = add_section(&shdrs, &shstrtab, ".debug_info", SHT_PROGBITS, 0);
+        sh->sh_offset = offset;
+        sh->sh_size = opts->debug;
+    }
+
+    buffer_align(out, 8, 0);
+    size_t offset = buffer_append(out, symtab.data, symtab.size);
+    Elf64_Shdr *sh = add_section(&shdrs, &shstrtab, ".symtab", SHT_SYMTAB, 0);
+    sh->sh_offset = offset;
+    sh->sh_size = symtab.size;
+    sh->sh_link = symtab_idx + 1;
+    sh->sh_info = 1;    // all symbols are global
+    sh->sh_entsize = sizeof(Elf64_Sym);
+    sh->sh_addralign = 8;
+
+    offset = buffer_append(out, strtab.data, strtab.size);
+    sh = add_section(&shdrs, &shstrtab, ".strtab", SHT_STRTAB, 0);
+    sh->sh_offset = offset;
+    sh->sh_size = strtab.size;
+
+    sh = add_section(&shdrs, &shstrtab, ".shstrtab", SHT_STRTAB, 0);
+    offset = buffer_append(out, shstrtab.data, shstrtab.size);
+    sh->sh_offset = offset;
+    sh->sh_size = shstrtab.size;
+
+    buffer_align(out, 8, 0);
+    offset = buffer_append(out, shdrs.data, shdrs.size);
+
+    Elf64_Ehdr *eh = (Elf64_Ehdr*) out->data;
+    memset(eh, 0, sizeof(Elf64_Ehdr));
+    memcpy(eh->e_ident, ELFMAG, SELFMAG);
+    eh->e_ident[EI_CLASS] = ELFCLASS64;
+    eh->e_ident[EI_DATA] = ELFDATA2LSB;
+    eh->e_ident[EI_VERSION] = EV_CURRENT;
+    eh->e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    eh->e_type = ET_REL;
+    eh->e_machine = EM_X86_64;
+    eh->e_version = EV_CURRENT;
+    eh->e_shoff = offset;
+    eh->e_ehsize = sizeof(Elf64_Ehdr);
+    eh->e_shentsize = sizeof(Elf64_Shdr);
+    eh->e_shnum = section_count(&shdrs);
+    eh->e_shstrndx = eh->e_shnum - 1;
+
+    if (eh->e_shnum != symtab_idx + 3) {
+        fprintf(stderr, "Internal error: unexpected number of sections\n");
+        exit(2);
+    }
+
+    buffer_clear(&shdrs);
+    buffer_clear(&shstrtab);
+    buffer_clear(&symtab);
+    buffer_clear(&strtab);
+    free(defined);
+    free(callees);
+}
+
+
+/*
+ * Get the global symbols defined by an object file built by make_object().
+ */
+static void defined_symbols(const struct buffer *obj, struct buffer *names, uint32_t *count)
+{
+    const Elf64_Ehdr *eh = (const Elf64_Ehdr*) obj->data;
+    const Elf64_Shdr *shdrs = (const Elf64_Shdr*) (obj->data + eh->e_shoff);
+    const Elf64_Shdr *symtab = &shdrs[eh->e_shnum - 3];
+    const Elf64_Shdr *strtab = &shdrs[eh->e_shnum - 2];
+    const Elf64_Sym *syms = (const Elf64_Sym*) (obj->data + symtab->sh_offset);
+
+    for (uint64_t i = 1; i < symtab->sh_size / sizeof(Elf64_Sym); ++i) {
+        if (syms[i].st_shndx != SHN_UNDEF) {
+            buffer_string(names, (const char*) (obj->data + strtab->sh_offset + syms[i].st_name));
+            ++*count;
+        }
+    }
+}
+
+
+static void ar_header(struct buffer *buf, const char *name, size_t size)
+{
+    char hdr[61];
+
+    snprintf(hdr, sizeof(hdr), "%-16s%-12s%-6s%-6s%-8s%-10zu`\n", name, "0", "0", "0", "644", size);
+    buffer_append(buf, hdr, 60);
+}
+
+
+static void write_be32(uint8_t *p, uint32_t value)
+{
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+
+/*
+ * Build a GNU style archive of object files.
+ */
+static void make_archive(const struct buffer *objects, const char **names, uint32_t n, bool index, struct buffer *out)
+{
+    struct buffer symnames = {0};
+    uint32_t *counts = calloc(n, sizeof(uint32_t));
+    uint32_t nsyms = 0;
+
+    for (uint32_t i = 0; i < n; ++i) {
+        defined_symbols(&objects[i], &symnames, &counts[i]);
+        nsyms += counts[i];
+    }
+
+    buffer_append(out, "!<arch>\n", 8);
+
+    size_t index_size = 4 + 4 * nsyms + symnames.size;
+    size_t offset = 8 + (index ? 60 + index_size + (index_size & 1) : 0);
+
+    if (index) {
+        ar_header(out, "/", index_size);
+        size_t pos = buffer_append(out, NULL, 4 + 4 * nsyms);
+        write_be32(out->data + pos, nsyms);
+
+        uint32_t sym = 0;
+        for (uint32_t i = 0; i < n; ++i) {
+            for (uint32_t j = 0; j < counts[i]; ++j, ++sym) {
+                write_be32(out->data + pos + 4 + 4 * sym, offset);
+            }
+            offset += 60 + objects[i].size + (objects[i].size & 1);
+        }
+
+        buffer_append(out, symnames.data, symnames.size);
+        buffer_align(out, 2, '\n');
+    }
+
+    for (uint32_t i = 0; i < n; ++i) {
+        char name[17];
+        snprintf(name, sizeof(name), "%s/", names[i]);
+        ar_header(out, name, objects[i].size);
+        buffer_append(out, objects[i].data, objects[i].size);
+        buffer_align(out, 2, '\n');
+    }
+
+    buffer_clear(&symnames);
+    free(counts);
+}
+
+
+static void write_file(const char *dir, const char *name, const struct buffer *buf)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL || fwrite(buf->data, 1, buf->size, fp) != buf->size || fclose(fp) != 0) {
+        fprintf(stderr, "Could not write '%s': %s\n", path, strerror(errno));
+        exit(1);
+    }
+}
+
+
+static void generate(struct generator *gen, const char *dir)
+{
+    const struct gen_options *opts = &gen->opts;
+    char path[4096];
+
+    make_functions(gen);
+
+    snprintf(path, sizeof(path), "%s/inputs", dir);
+    FILE *inputs = fopen(path, "w");
+    if (inputs == NULL) {
+        fprintf(stderr, "Could not write '%s': %s\n", path, strerror(errno));
+        exit(1);
+    }
+
+    uint32_t members = opts->members > 0 ? opts->members : 1;
+    struct buffer *objects = calloc(members, sizeof(struct buffer));
+    char (*names)[16] = calloc(members, sizeof(*names));
+    const char **namelist = calloc(members, sizeof(char*));
+
+    uint32_t object = 0;
+    for (; object < opts->loose && object < opts->nobjects; ++object) {
+        char name[16];
+        snprintf(name, sizeof(name), "obj%05u.o", object);
+
+        make_object(gen, object, &objects[0]);
+        write_file(dir, name, &objects[0]);
+        buffer_clear(&objects[0]);
+        fprintf(inputs, "%s\n", name);
+    }
+
+    for (uint32_t archive = 0; object < opts->nobjects; ++archive) {
+        uint32_t n = 0;
+
+        for (; n < members && object < opts->nobjects; ++n, ++object) {
+            snprintf(names[n], sizeof(names[n]), "obj%05u.o", object);
+            namelist[n] = names[n];
+            make_object(gen, object, &objects[n]);
+        }
+
+        struct buffer ar = {0};
+        char name[32];
+        snprintf(name, sizeof(name), "lib%04u.a", archive);
+
+        make_archive(objects, namelist, n, opts->index, &ar);
+        write_file(dir, name, &ar);
+        buffer_clear(&ar);
+        fprintf(inputs, "%s\n", name);
+
+        for (uint32_t i = 0; i < n; ++i) {
+            buffer_clear(&objects[i]);
+        }
+    }
+
+    fclose(inputs);
+    free(objects);
+    free(names);
+    free(namelist);
+
+    for (uint64_t i = 0; i < gen->nregular + gen->ninline; ++i) {
+        free(gen->functions[i].name);
+    }
+    free(gen->functions);
+    free(gen->symidx);
+    free(gen->stamp);
+}
+
+
+static void usage(FILE *fp, const char *prog)
+{
+    fprintf(fp, "Usage: %s [OPTIONS] DIR\n", prog);
+    fprintf(fp, "Options:\n");
+    fprintf(fp, "  --objects N          Number of object files (default 100).\n");
+    fprintf(fp, "  --functions N        Functions defined in every object file (default 50).\n");
+    fprintf(fp, "  --name-length N      Mean symbol name length (default 40).\n");
+    fprintf(fp, "  --comdat PCT         Percentage of inline functions in COMDAT groups (default 20).\n");
+    fprintf(fp, "  --relocs N           Calls made by every function (default 4).\n");
+    fprintf(fp, "  --dead PCT           Percentage of functions never called (default 25).\n");
+    fprintf(fp, "  --members N          Object files in every archive, 0 for no archives (default 50).\n");
+    fprintf(fp, "  --loose N            Object files given directly to the linker (default 10).\n");
+    fprintf(fp, "  --debug BYTES        Size of a debug section in every object file (default 0).\n");
+    fprintf(fp, "  --no-index           Do not write symbol indexes in archives.\n");
+    fprintf(fp, "  --seed N             Random seed (default 1).\n");
+}
+
+
+static bool parse_uint(const char *s, uint32_t max, uint32_t *value)
+{
+    char *end = NULL;
+    unsigned long n = strtoul(s, &end, 10);
+
+    if (*s == '\0' || *end != '\0' || n > max) {
+        return false;
+    }
+
+    *value = n;
+    return true;
+}
+
+
+int main(int argc, char **argv)
+{
+    struct generator gen = {
+        .opts = {
+            .nobjects = 100,
+            .nfunctions = 50,
+            .name_length = 40,
+            .comdat = 20,
+            .relocs = 4,
+            .dead = 25,
+            .members = 50,
+            .loose = 10,
+            .debug = 0,
+            .index = true,
+            .seed = 1
+        }
+    };
+    struct gen_options *opts = &gen.opts;
+
+    struct option options[] = {
+        {"objects", required_argument, 0, 'n'},
+        {"functions", required_argument, 0, 'f'},
+        {"name-length", required_argument, 0, 'l'},
+        {"comdat", required_argument, 0, 'c'},
+        {"relocs", required_argument, 0, 'r'},
+        {"dead", required_argument, 0, 'd'},
+        {"members", required_argument, 0, 'm'},
+        {"loose", required_argument, 0, 'L'},
+        {"debug", required_argument, 0, 'g'},
+        {"no-index", no_argument, 0, 'N'},
+        {"seed", required_argument, 0, 's'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        bool ok = true;
+        uint32_t seed = 0;
+
+        switch (c) {
+            case 'n': ok = parse_uint(optarg, 100000, &opts->nobjects); break;
+            case 'f': ok = parse_uint(optarg, 100000, &opts->nfunctions); break;
+            case 'l': ok = parse_uint(optarg, 1000, &opts->name_length); break;
+            case 'c': ok = parse_uint(optarg, 100, &opts->comdat); break;
+            case 'r': ok = parse_uint(optarg, 1000, &opts->relocs); break;
+            case 'd': ok = parse_uint(optarg, 100, &opts->dead); break;
+            case 'm': ok = parse_uint(optarg, 100000, &opts->members); break;
+            case 'L': ok = parse_uint(optarg, 100000, &opts->loose); break;
+            case 'g': ok = parse_uint(optarg, 1 << 30, &opts->debug); break;
+            case 'N': opts->index = false; break;
+            case 's': ok = parse_uint(optarg, UINT32_MAX, &seed); opts->seed = seed; break;
+            case 'h': usage(stdout, argv[0]); return 0;
+            default: usage(stderr, argv[0]); return 1;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "Invalid value for option '%s': '%s'\n", argv[optind - 1], optarg);
+            return 1;
+        }
+    }
+
+    if (optind + 1 != argc) {
+        usage(stderr, argv[0]);
+        return 1;
+    }
+
+    if (opts->nobjects == 0 || opts->nfunctions == 0) {
+        fprintf(stderr, "At least one object file with one function is required\n");
+        return 1;
+    }
+
+    if (opts->members == 0) {
+        opts->loose = opts->nobjects;
+    }
+
+    if (opts->loose == 0) {
+        // The entry point is defined in the first object file
+        opts->loose = 1;
+    }
+
+    const char *dir = argv[optind];
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Could not create directory '%s': %s\n", dir, strerror(errno));
+        return 1;
+    }
+
+    gen.rng = opts->seed * 0x9e3779b97f4a7c15ULL + 1;
+    generate(&gen, dir);
+    return 0;
+}
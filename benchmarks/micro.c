@@ -0,0 +1,890 @@
+/*
+ * Microbenchmarks of the data structures the linker is built on.
+ *
+ * Every benchmark runs an operation over a corpus of symbol names
+ * and reports the time per operation and, if hardware performance
+ * counters are available, the cache misses per operation. The corpus
+ * is read from a file with one name per line, for example the output
+ * of `nm --format=just-symbols`, or generated if no file is given.
+ */
+#include "utils/deque.h"
+#include "utils/cdeque.h"
+#include "utils/table.h"
+#include "utils/rbtree.h"
+#include "utils/hash.h"
+#include "strpool.h"
+#include "globals.h"
+#include "symbol.h"
+#include "archives.h"
+#include "archive.h"
+#include "mfile.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+
+#define NMEMBERS    64
+
+
+/*
+ * Symbol names to run the benchmarks on.
+ */
+struct corpus
+{
+    char **names;           // names in corpus order
+    char **shuffled;        // the same names in random order, for lookups
+    uint64_t count;         // number of names
+    char *strtab;           // names as an ELF string table
+    uint64_t strtab_size;   // size of the string table
+};
+
+
+/*
+ * Measurement of a benchmark run.
+ */
+struct measurement
+{
+    int fd;                 // cache miss counter (-1 if unavailable)
+    uint64_t start;         // start time
+    uint64_t ns;            // elapsed time
+    uint64_t misses;        // cache misses
+    uint64_t ops;           // number of operations
+};
+
+
+/*
+ * Benchmark of a single operation.
+ */
+struct benchmark
+{
+    const char *name;
+    void (*run)(const struct corpus *corpus, struct measurement *m);
+};
+
+
+// Results are accumulated here, so the compiler can't remove the work
+static volatile uint64_t sink;
+
+
+static uint64_t clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static int open_cache_miss_counter(void)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+
+static void measure_begin(struct measurement *m)
+{
+    if (m->fd >= 0) {
+        ioctl(m->fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m->fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    m->start = clock_ns();
+}
+
+
+static void measure_end(struct measurement *m, uint64_t ops)
+{
+    m->ns = clock_ns() - m->start;
+    m->ops = ops;
+    m->misses = 0;
+
+    if (m->fd >= 0) {
+        uint64_t count = 0;
+        ioctl(m->fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(m->fd, &count, sizeof(count)) == sizeof(count)) {
+            m->misses = count;
+        }
+    }
+}
+
+
+static void bench_hash_fnv1a_32(const struct corpus *corpus, struct measurement *m)
+{
+    uint32_t hash = 0;
+
+    measure_begin(m);
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        hash ^= hash_fnv1a_32(corpus->names[i], strlen(corpus->names[i]));
+    }
+    measure_end(m, corpus->count);
+
+    sink += hash;
+}
+
+
+static void bench_deque_push_back(const struct corpus *corpus, struct measurement *m)
+{
+    struct deque d = DEQUE_INIT;
+
+    measure_begin(m);
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        deque_push_back(&d, corpus->names[i]);
+    }
+    measure_end(m, corpus->count);
+
+    sink += deque_size(&d);
+    deque_clear(&d);
+}
+
+
+static void bench_deque_pop_front(const struct corpus *corpus, struct measurement *m)
+{
+    struct deque d = DEQUE_INIT;
+    uint64_t n = 0;
+
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        deque_push_back(&d, corpus->names[i]);
+    }
+
+    measure_begin(m);
+    while (deque_pop_front(&d) != NULL) {
+        ++n;
+    }
+    measure_end(m, n);
+
+    sink += n;
+    deque_clear(&d);
+}
+
+
+static void bench_cdeque_push_back(const struct corpus *corpus, struct measurement *m)
+{
+    struct cdeque d = CDEQUE_INIT;
+
+    measure_begin(m);
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        cdeque_push_back(&d, corpus->names[i]);
+    }
+    measure_end(m, corpus->count);
+
+    sink += cdeque_size(&d);
+    cdeque_clear(&d);
+}
+
+
+static void bench_cdeque_pop_back(const struct corpus *corpus, struct measurement *m)
+{
+    struct cdeque d = CDEQUE_INIT;
+    uint64_t n = 0;
+
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        cdeque_push_back(&d, corpus->names[i]);
+    }
+
+    measure_begin(m);
+    while (cdeque_pop_back(&d) != NULL) {
+        ++n;
+    }
+    measure_end(m, n);
+
+    sink += n;
+    cdeque_clear(&d);
+}
+
+
+static void bench_cdeque_pop_front(const struct corpus *corpus, struct measurement *m)
+{
+    struct cdeque d = CDEQUE_INIT;
+    uint64_t n = 0;
+
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        cdeque_push_back(&d, corpus->names[i]);
+    }
+
+    measure_begin(m);
+    while (cdeque_pop_front(&d) != NULL) {
+        ++n;
+    }
+    measure_end(m, n);
+
+    sink += n;
+    cdeque_clear(&d);
+}
+
+
+/*
+ * Worklist shared by threads that drain it concurrently, either a
+ * struct deque behind a mutex or a struct cdeque. The owner pops at 
+ * the back while the other threads pop at the front.
+ */
+struct shared_worklist
+{
+    struct deque deque;
+    pthread_mutex_t lock;
+    struct cdeque cdeque;
+    bool concurrent;
+    uint64_t popped;
+};
+
+
+#define WORKLIST_THREADS 4
+
+
+static uint64_t drain_worklist(struct shared_worklist *w, bool owner)
+{
+    uint64_t n = 0;
+    void *entry;
+
+    if (w->concurrent) {
+        while ((entry = owner ? cdeque_pop_back(&w->cdeque) : cdeque_pop_front(&w->cdeque)) != NULL) {
+            ++n;
+        }
+    } else {
+        do {
+            pthread_mutex_lock(&w->lock);
+            entry = owner ? deque_pop_back(&w->deque) : deque_pop_front(&w->deque);
+            pthread_mutex_unlock(&w->lock);
+            n += entry != NULL;
+        } while (entry != NULL);
+    }
+
+    return n;
+}
+
+
+static void * drain_worker(void *arg)
+{
+    struct shared_worklist *w = arg;
+    uint64_t n = drain_worklist(w, false);
+    __atomic_add_fetch(&w->popped, n, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+
+/*
+ * Measure how fast a worklist is drained by several threads.
+ * Cache misses are only counted for the calling thread.
+ */
+static void drain_concurrently(const struct corpus *corpus, struct measurement *m, bool concurrent)
+{
+    struct shared_worklist w = {
+        .deque = DEQUE_INIT,
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .cdeque = CDEQUE_INIT,
+        .concurrent = concurrent,
+        .popped = 0
+    };
+    pthread_t threads[WORKLIST_THREADS - 1];
+    int started = 0;
+
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        if (concurrent) {
+            cdeque_push_back(&w.cdeque, corpus->names[i]);
+        } else {
+            deque_push_back(&w.deque, corpus->names[i]);
+        }
+    }
+
+    measure_begin(m);
+    for (int i = 0; i < WORKLIST_THREADS - 1; ++i) {
+        if (pthread_create(&threads[i], NULL, drain_worker, &w) == 0) {
+            ++started;
+        }
+    }
+    uint64_t n = drain_worklist(&w, true);
+    for (int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    n += w.popped;
+    measure_end(m, n);
+
+    sink += n;
+    deque_clear(&w.deque);
+    cdeque_clear(&w.cdeque);
+}
+
+
+static void bench_deque_drain_locked(const struct corpus *corpus, struct measurement *m)
+{
+    drain_concurrently(corpus, m, false);
+}
+
+
+static void bench_cdeque_drain(const struct corpus *corpus, struct measurement *m)
+{
+    drain_concurrently(corpus, m, true);
+}
+
+
+static void bench_table_insert(const struct corpus *corpus, struct measurement *m)
+{
+    struct table t = TABLE_INIT;
+
+    measure_begin(m);
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        table_insert(&t, i, corpus->names[i], NULL);
+    }
+    measure_end(m, corpus->count);
+
+    sink += t.capacity;
+    table_clear(&t);
+}
+
+
+struct name_node
+{
+    struct rb_node node;
+    const char *name;
+};
+
+
+static int compare_nodes(const struct rb_node *a, const struct rb_node *b)
+{
+    return strcmp(rb_entry(a, struct name_node, node)->name, rb_entry(b, struct name_node, node)->name);
+}
+
+
+static int compare_key(const void *key, const struct rb_node *node)
+{
+    return strcmp(key, rb_entry(node, struct name_node, node)->name);
+}
+
+
+static struct name_node * build_tree(const struct corpus *corpus, struct rb_tree *tree, struct measurement *m)
+{
+    struct name_node *nodes = calloc(corpus->count, sizeof(struct name_node));
+
+    rb_tree_init(tree);
+
+    if (m != NULL) {
+        measure_begin(m);
+    }
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        rb_node_init(&nodes[i].node);
+        nodes[i].name = corpus->names[i];
+        rb_add(tree, &nodes[i].node, compare_nodes);
+    }
+    if (m != NULL) {
+        measure_end(m, corpus->count);
+    }
+
+    return nodes;
+}
+
+
+static void bench_rb_add(const struct corpus *corpus, struct measurement *m)
+{
+    struct rb_tree tree;
+    struct name_node *nodes = build_tree(corpus, &tree, m);
+    sink += tree.root != NULL;
+    free(nodes);
+}
+
+
+static void bench_rb_find(const struct corpus *corpus, struct measurement *m)
+{
+    struct rb_tree tree;
+    struct name_node *nodes = build_tree(corpus, &tree, NULL);
+    uint64_t found = 0;
+
+    measure_begin(m);
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        found += rb_find(&tree, corpus->shuffled[i], compare_key) != NULL;
+    }
+    measure_end(m, corpus->count);
+
+    sink += found;
+    free(nodes);
+}
+
+
+static void bench_strpool_intern(const struct corpus *corpus, struct measurement *m)
+{
+    struct strpool pool = {0};
+    uint64_t sum = 0;
+
+    measure_begin(m);
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        sum += strpool_intern(&pool, corpus->names[i]);
+    }
+    measure_end(m, corpus->count);
+
+    sink += sum;
+    strpool_clear(&pool);
+}
+
+
+static void bench_strpool_lookup(const struct corpus *corpus, struct measurement *m)
+{
+    struct strpool pool = {0};
+    uint64_t sum = 0;
+
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        strpool_intern(&pool, corpus->names[i]);
+    }
+
+    measure_begin(m);
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        sum += strpool_lookup(&pool, corpus->shuffled[i]);
+    }
+    measure_end(m, corpus->count);
+
+    sink += sum;
+    strpool_clear(&pool);
+}
+
+
+static void bench_strpool_pack(const struct corpus *corpus, struct measurement *m)
+{
+    struct strpool pool = {0};
+
+    measure_begin(m);
+    sink += strpool_pack(&pool, corpus->strtab, corpus->strtab_size);
+    measure_end(m, corpus->count);
+
+    strpool_clear(&pool);
+}
+
+
+static struct symbol ** alloc_symbols(const struct corpus *corpus, struct strpool *strings)
+{
+    struct symbol **symbols = malloc(sizeof(struct symbol*) * corpus->count);
+
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        symbols[i] = symbol_alloc_strings(strings, corpus->names[i], SYMBOL_FUNCTION, SYMBOL_GLOBAL);
+    }
+
+    return symbols;
+}
+
+
+static void put_symbols(const struct corpus *corpus, struct symbol **symbols)
+{
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        symbol_put(symbols[i]);
+    }
+    free(symbols);
+}
+
+
+static void bench_globals_insert_symbol(const struct corpus *corpus, struct measurement *m)
+{
+    struct strpool *strings = strpool_alloc();
+    struct symbol **symbols = alloc_symbols(corpus, strings);
+    struct globals globals = {0};
+
+    measure_begin(m);
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        globals_insert_symbol(&globals, symbols[i], NULL);
+    }
+    measure_end(m, corpus->count);
+
+    sink += globals.nglobals;
+    globals_clear(&globals);
+    put_symbols(corpus, symbols);
+    strpool_put(strings);
+}
+
+
+static void bench_globals_find_symbol(const struct corpus *corpus, struct measurement *m)
+{
+    struct strpool *strings = strpool_alloc();
+    struct symbol **symbols = alloc_symbols(corpus, strings);
+    struct globals globals = {0};
+    uint64_t found = 0;
+
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        globals_insert_symbol(&globals, symbols[i], NULL);
+    }
+
+    measure_begin(m);
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        found += globals_find_symbol(&globals, corpus->shuffled[i]) != NULL;
+    }
+    measure_end(m, corpus->count);
+
+    sink += found;
+    globals_clear(&globals);
+    put_symbols(corpus, symbols);
+    strpool_put(strings);
+}
+
+
+static struct mfile archive_file = {
+    .name = "bench.a",
+    .refcnt = 1,
+    .fd = -1,
+    .size = NMEMBERS * 128,
+    .mtime = 0,
+    .data = NULL
+};
+
+
+static struct archive * create_archive(void)
+{
+    struct archive *ar = archive_alloc(&archive_file, "bench.a", NULL, 0);
+
+    for (size_t i = 0; i < NMEMBERS; ++i) {
+        archive_add_member(ar, i * 128, i * 128, 128);
+    }
+
+    return ar;
+}
+
+
+static void bench_archives_insert_symbol(const struct corpus *corpus, struct measurement *m)
+{
+    struct archive *ar = create_archive();
+    struct archives index = {0};
+
+    measure_begin(m);
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        archives_insert_symbol(&index, &ar->members[i % NMEMBERS], corpus->names[i]);
+    }
+    measure_end(m, corpus->count);
+
+    sink += index.entries;
+    archives_clear_symbols(&index);
+    archive_put(ar);
+}
+
+
+static void find_archive_symbols(const struct corpus *corpus, struct measurement *m, bool freeze)
+{
+    struct archive *ar = create_archive();
+    struct archives index = {0};
+    uint64_t found = 0;
+
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        archives_insert_symbol(&index, &ar->members[i % NMEMBERS], corpus->names[i]);
+    }
+
+    if (freeze) {
+        archives_freeze(&index);
+    }
+
+    measure_begin(m);
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        found += archives_find_symbol(&index, corpus->shuffled[i]) != NULL;
+    }
+    measure_end(m, corpus->count);
+
+    sink += found;
+    archives_clear_symbols(&index);
+    archive_put(ar);
+}
+
+
+static void bench_archives_find_symbol(const struct corpus *corpus, struct measurement *m)
+{
+    find_archive_symbols(corpus, m, false);
+}
+
+
+static void bench_archives_find_symbol_frozen(const struct corpus *corpus, struct measurement *m)
+{
+    find_archive_symbols(corpus, m, true);
+}
+
+
+static const struct benchmark benchmarks[] = {
+    {"hash_fnv1a_32", bench_hash_fnv1a_32},
+    {"deque_push_back", bench_deque_push_back},
+    {"deque_pop_front", bench_deque_pop_front},
+    {"deque_drain/locked4", bench_deque_drain_locked},
+    {"cdeque_push_back", bench_cdeque_push_back},
+    {"cdeque_pop_back", bench_cdeque_pop_back},
+    {"cdeque_pop_front", bench_cdeque_pop_front},
+    {"cdeque_drain/4", bench_cdeque_drain},
+    {"table_insert", bench_table_insert},
+    {"rb_add", bench_rb_add},
+    {"rb_find", bench_rb_find},
+    {"strpool_intern", bench_strpool_intern},
+    {"strpool_lookup", bench_strpool_lookup},
+    {"strpool_pack", bench_strpool_pack},
+    {"globals_insert_symbol", bench_globals_insert_symbol},
+    {"globals_find_symbol", bench_globals_find_symbol},
+    {"archives_insert_symbol", bench_archives_insert_symbol},
+    {"archives_find_symbol", bench_archives_find_symbol},
+    {"archives_find_symbol/frozen", bench_archives_find_symbol_frozen},
+};
+
+
+static bool add_name(struct corpus *corpus, uint64_t *capacity, const char *name)
+{
+    if (corpus->count == *capacity) {
+        *capacity = *capacity > 0 ? *capacity * 2 : 1024;
+        char **names = realloc(corpus->names, sizeof(char*) * *capacity);
+        if (names == NULL) {
+            return false;
+        }
+        corpus->names = names;
+    }
+
+    corpus->names[corpus->count] = strdup(name);
+    return corpus->names[corpus->count++] != NULL;
+}
+
+
+static bool read_corpus(struct corpus *corpus, const char *pathname, uint64_t limit)
+{
+    uint64_t capacity = 0;
+    char line[4096];
+
+    FILE *fp = fopen(pathname, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open corpus '%s': %s\n", pathname, strerror(errno));
+        return false;
+    }
+
+    while (corpus->count < limit && fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0' && !add_name(corpus, &capacity, line)) {
+            fclose(fp);
+            return false;
+        }
+    }
+
+    fclose(fp);
+    return true;
+}
+
+
+/*
+ * Generate names that look like mangled C++ names from a large code base,
+ * with long common prefixes and a spread of lengths.
+ */
+static bool generate_corpus(struct corpus *corpus, uint64_t count)
+{
+    static const char *namespaces[] = {"3std", "5boost", "4llvm", "5clang", "6google", "8protobuf", "4absl", "3app"};
+    static const char *classes[] = {"6vector", "3map", "13unordered_map", "6string", "10shared_ptr", "4Pass",
+                                    "8Function", "10BasicBlock", "11Instruction", "12MemoryBuffer", "7Context"};
+    static const char *params[] = {"v", "i", "Ev", "RKS_", "PKc", "mm", "RKNS_6stringE", "S1_S2_"};
+    uint64_t capacity = 0;
+    uint64_t rng = 88172645463325252ULL;
+    char unique[32];
+    char name[512];
+
+    for (uint64_t i = 0; i < count; ++i) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+
+        snprintf(unique, sizeof(unique), "f%llu", (unsigned long long) i);
+        snprintf(name, sizeof(name), "_ZN%s%s%sI%sE%zu%sE%s",
+                 namespaces[rng % 8],
+                 (rng >> 8) % 3 == 0 ? "6detail" : "",
+                 classes[(rng >> 16) % 11],
+                 classes[(rng >> 24) % 11],
+                 strlen(unique), unique,
+                 params[(rng >> 32) % 8]);
+
+        if (!add_name(corpus, &capacity, name)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+static bool prepare_corpus(struct corpus *corpus)
+{
+    uint64_t rng = 2463534242ULL;
+
+    corpus->shuffled = malloc(sizeof(char*) * corpus->count);
+    if (corpus->shuffled == NULL) {
+        return false;
+    }
+    memcpy(corpus->shuffled, corpus->names, sizeof(char*) * corpus->count);
+
+    for (uint64_t i = corpus->count; i > 1; --i) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        uint64_t j = rng % i;
+        char *tmp = corpus->shuffled[i - 1];
+        corpus->shuffled[i - 1] = corpus->shuffled[j];
+        corpus->shuffled[j] = tmp;
+    }
+
+    corpus->strtab_size = 1;
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        corpus->strtab_size += strlen(corpus->names[i]) + 1;
+    }
+
+    corpus->strtab = malloc(corpus->strtab_size);
+    if (corpus->strtab == NULL) {
+        return false;
+    }
+
+    uint64_t offset = 0;
+    corpus->strtab[offset++] = '\0';
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        size_t len = strlen(corpus->names[i]) + 1;
+        memcpy(corpus->strtab + offset, corpus->names[i], len);
+        offset += len;
+    }
+
+    return true;
+}
+
+
+static void clear_corpus(struct corpus *corpus)
+{
+    for (uint64_t i = 0; i < corpus->count; ++i) {
+        free(corpus->names[i]);
+    }
+    free(corpus->names);
+    free(corpus->shuffled);
+    free(corpus->strtab);
+}
+
+
+static void usage(FILE *fp, const char *prog)
+{
+    fprintf(fp, "Usage: %s [OPTIONS] [BENCHMARK...]\n", prog);
+    fprintf(fp, "Options:\n");
+    fprintf(fp, "  --corpus FILE        Read symbol names from file, one per line.\n");
+    fprintf(fp, "  --count N            Number of symbol names to use (default 100000).\n");
+    fprintf(fp, "  --repeat N           Runs per benchmark, the fastest is reported (default 5).\n");
+    fprintf(fp, "  --list               List benchmarks.\n");
+    fprintf(fp, "Benchmarks are selected by name prefix, all are run by default.\n");
+}
+
+
+static bool selected(const char *name, int argc, char **argv)
+{
+    if (argc == 0) {
+        return true;
+    }
+
+    for (int i = 0; i < argc; ++i) {
+        if (strncmp(name, argv[i], strlen(argv[i])) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *corpus_file = NULL;
+    uint64_t count = 100000;
+    uint64_t repeat = 5;
+    struct corpus corpus = {0};
+
+    struct option options[] = {
+        {"corpus", required_argument, 0, 'c'},
+        {"count", required_argument, 0, 'n'},
+        {"repeat", required_argument, 0, 'r'},
+        {"list", no_argument, 0, 'l'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (c) {
+            case 'c':
+                corpus_file = optarg;
+                break;
+
+            case 'n':
+                count = strtoull(optarg, NULL, 10);
+                break;
+
+            case 'r':
+                repeat = strtoull(optarg, NULL, 10);
+                break;
+
+            case 'l':
+                for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i) {
+                    printf("%s\n", benchmarks[i].name);
+                }
+                return 0;
+
+            case 'h':
+                usage(stdout, argv[0]);
+                return 0;
+
+            default:
+                usage(stderr, argv[0]);
+                return 1;
+        }
+    }
+
+    if (count == 0 || repeat == 0) {
+        usage(stderr, argv[0]);
+        return 1;
+    }
+
+    bool ok = corpus_file != NULL ? read_corpus(&corpus, corpus_file, count) : generate_corpus(&corpus, count);
+    if (!ok || corpus.count == 0 || !prepare_corpus(&corpus)) {
+        fprintf(stderr, "Could not prepare corpus\n");
+        clear_corpus(&corpus);
+        return 1;
+    }
+
+    struct measurement m = { .fd = open_cache_miss_counter() };
+
+    printf("Corpus: %llu names (%s), mean length %.1f\n",
+           (unsigned long long) corpus.count,
+           corpus_file != NULL ? corpus_file : "generated",
+           (double) (corpus.strtab_size - 1) / corpus.count - 1);
+    if (m.fd < 0) {
+        printf("Cache miss counter is not available: %s\n", strerror(errno));
+    }
+    printf("%-30s %12s %14s\n", "Benchmark", "ns/op", "misses/op");
+
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i) {
+        const struct benchmark *bench = &benchmarks[i];
+        struct measurement best = {0};
+
+        if (!selected(bench->name, argc - optind, argv + optind)) {
+            continue;
+        }
+
+        for (uint64_t run = 0; run < repeat; ++run) {
+            bench->run(&corpus, &m);
+            if (run == 0 || m.ns < best.ns) {
+                best = m;
+            }
+        }
+
+        printf("%-30s %12.2f ", bench->name, (double) best.ns / best.ops);
+        if (m.fd >= 0) {
+            printf("%14.3f\n", (double) best.misses / best.ops);
+        } else {
+            printf("%14s\n", "-");
+        }
+    }
+
+    if (m.fd >= 0) {
+        close(m.fd);
+    }
+    clear_corpus(&corpus);
+    return 0;
+}
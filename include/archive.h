@@ -7,7 +7,6 @@ extern "C" {
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
-#include "strpool.h"
 #include "utils/list.h"
 
 
@@ -15,6 +14,7 @@ extern "C" {
 struct mfile;
 struct objectfile;
 struct archive_member;
+struct archive_reader;
 
 
 /*
@@ -32,7 +32,8 @@ struct archive
     size_t file_size;           // total size of the file
     struct archive_member *members; // dynamic array of archive members
     size_t nmembers;            // number of archive members
-    struct strpool names;       // member names
+    const struct archive_reader *reader; // reader used to parse the archive (used to look up member names)
+    bool has_symbol_index;      // does the archive have a symbol index (ranlib)?
 };
 
 
@@ -45,11 +46,12 @@ struct archive
 struct archive_member
 {
     struct archive *archive;    // weak reference to the archive 
-    uint64_t name;              // archive member name (offset in the string pool)
+    size_t header;              // offset to the member header (used to look up the name)
     size_t offset;              // offset to the member file
     size_t size;                // size of the member file
     const uint8_t *content;     // pointer to member content
-    struct objectfile *objfile; // lazily loaded object file reference
+    struct objectfile *objfile; // weak reference to the extracted object file (cleared when it is released)
+    bool extracted;             // has the member been extracted?
 };
 
 
@@ -73,9 +75,12 @@ void archive_put(struct archive *archive);
 
 /*
  * Add an archive member file.
+ *
+ * Member names are not stored, but looked up from the member
+ * header when they are needed, see archive_member_name().
  */
 struct archive_member * archive_add_member(struct archive *archive,
-                                           const char *name,
+                                           size_t header,
                                            size_t offset,
                                            size_t size);
 
@@ -94,6 +99,7 @@ struct archive_member * archive_get_member(const struct archive *archive, size_t
  *
  * Note that this takes an object file handle reference,
  * so the caller must call objectfile_put() to relase it.
+ * The object file holds a reference to the archive.
  */
 struct objectfile * archive_extract_member(struct archive_member *member);
 
@@ -101,23 +107,21 @@ struct objectfile * archive_extract_member(struct archive_member *member);
 /*
  * Get the name of the archive member.
  *
- * Note that this string must NOT be stored, as its lifetime
- * depends on the underlying string pool used by the archive.
+ * The name is looked up in the archive file by the archive reader
+ * and written to name, truncated to len bytes including the
+ * terminating NUL. Returns the full length of the name, or 0 if
+ * the name is not known.
  */
-static inline
-const char * archive_member_name(struct archive_member *member)
-{
-    return strpool_at(&member->archive->names, member->name);
-}
+size_t archive_member_name(const struct archive_member *member, char *name, size_t len);
 
 
 /*
  * Helper function to determine if an archive member was already extracted.
  */
 static inline
-bool archive_is_member_extracted(struct archive_member *member)
+bool archive_is_member_extracted(const struct archive_member *member)
 {
-    return member->objfile != NULL;
+    return member->extracted;
 }
 
 
@@ -34,6 +34,20 @@ struct archive_reader
                       size_t file_size,
                       struct archive *archive,
                       struct archives *index);
+
+    /*
+     * Look up the name of the member with the header at the given
+     * offset. At most len bytes are written to name, including the
+     * terminating NUL. Returns the full length of the name, or 0
+     * if the name could not be found.
+     *
+     * This must be safe to call concurrently.
+     */
+    size_t (*member_name)(const uint8_t *file_data,
+                          size_t file_size,
+                          size_t header,
+                          char *name,
+                          size_t len);
 };
 
 
@@ -8,11 +8,13 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 #include "strpool.h"
+#include "tablestats.h"
 
 /* Some forward declarations */
 struct archive;
 struct archive_member;
 struct archive_symbol;
+struct archives_frozen;
 
 
 /*
@@ -38,6 +40,8 @@ struct archives
     uint64_t entries;               // entries in the symbol index
     uint64_t rehash_threshold;      // rehash threshold for the symbol index
     struct strpool names;           // string pool for symbol names
+    struct archives_frozen *frozen; // read-only perfect hash index (NULL if not frozen)
+    struct table_stats stats;       // hash table statistics
 };
 
 
@@ -80,6 +84,16 @@ bool archives_insert_symbol(struct archives *index,
                             const char *symbol_name);
 
 
+/*
+ * Merge the symbols of another archive index into the archive index.
+ *
+ * Symbols already present in the index are kept, so merging several
+ * indexes in order preserves first-archive-wins. Hashes stored in
+ * the other index are reused, names are interned again.
+ */
+bool archives_merge(struct archives *index, const struct archives *other);
+
+
 /*
  * Try to look up the archive member where a symbol is defined.
  */
@@ -87,6 +101,67 @@ struct archive_member * archives_find_symbol(const struct archives *index,
                                              const char *symbol_name);
 
 
+/*
+ * Freeze the archive index.
+ *
+ * Once all input files are read, the index is only used for lookups.
+ * Freezing rebuilds the hash table into a minimal perfect hash
+ * (hash and displace), where every symbol has a slot of its own and a
+ * lookup reads one displacement and one slot with a fingerprint before
+ * comparing the name.
+ *
+ * Inserting a symbol into a frozen index thaws it again.
+ *
+ * Returns false if the perfect hash could not be built, in which
+ * case the index is left unchanged.
+ */
+bool archives_freeze(struct archives *index);
+
+
+/*
+ * Is the archive index frozen?
+ */
+static inline
+bool archives_is_frozen(const struct archives *index)
+{
+    return index->frozen != NULL;
+}
+
+
+/*
+ * Write a frozen archive index to file.
+ *
+ * The frozen index is a position-independent memory image, which
+ * can be loaded again with archives_load_frozen() as an index cache.
+ */
+bool archives_save_frozen(const struct archives *index, const char *pathname);
+
+
+/*
+ * Add symbols from a frozen archive index image to the archive index.
+ *
+ * Every archive referenced by the image must match one of the given 
+ * archives by name, file size and modification time. If it does not,
+ * the image is considered stale and the function returns false 
+ * without modifying the index.
+ */
+bool archives_load_frozen(struct archives *index,
+                          struct archive **archives,
+                          size_t narchives,
+                          const uint8_t *image,
+                          size_t size);
+
+
+/*
+ * Get statistics for the archive index' hash table.
+ *
+ * If the hash table has been released by freezing or clearing
+ * the index, the shape of the table as it was before is reported.
+ * Lookups in a frozen index always count as a single probe.
+ */
+void archives_table_stats(const struct archives *index, struct table_stats *stats);
+
+
 /*
  * Clear an archive index and remove all symbol entries.
  */
@@ -10,6 +10,7 @@ extern "C" {
 #include <string.h>
 #include "symbol.h"
 #include "utils/hash.h"
+#include "tablestats.h"
 
 
 /* Forward declaration */
@@ -43,6 +44,7 @@ struct globals
     uint64_t capacity;          // capacity of the hash table
     uint64_t nglobals;          // number of global symbols in the hash table
     uint64_t rehash_threshold;  // rehashing threshold
+    struct table_stats stats;   // hash table statistics
 };
 
 
@@ -75,6 +77,7 @@ struct symbol * globals_find_symbol(const struct globals *g, const char *name)
     while (this->hash != 0 && dfi <= this->dfi) {
         if (this->hash == hash) {
             if (strcmp(name, symbol_name(this->symbol)) == 0) {
+                table_stats_lookup(&g->stats, true, dfi + 1);
                 return this->symbol;
             }
         }
@@ -84,10 +87,17 @@ struct symbol * globals_find_symbol(const struct globals *g, const char *name)
         ++dfi;
     }
 
+    table_stats_lookup(&g->stats, false, dfi + 1);
     return NULL;
 }
 
 
+/*
+ * Get statistics for the global symbol index' hash table.
+ */
+void globals_table_stats(const struct globals *g, struct table_stats *stats);
+
+
 /*
  * Remove symbol from the global symbol index.
  */
@@ -117,9 +127,11 @@ int globals_insert_symbol(struct globals *g,
 
 
 /*
- * Remove all symbols in the index that isn't marked as alive.
+ * Remove all symbols in the index that aren't alive after dead code 
+ * elimination (see symbol_is_alive()), and shrink the hash table to
+ * fit the remaining symbols. Returns the number of symbols removed.
  */
-//void globals_undefine_symbols(struct globals *g);
+uint64_t globals_remove_unused_symbols(struct globals *g);
 
 
 /*
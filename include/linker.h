@@ -7,6 +7,7 @@ extern "C" {
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include "utils/list.h"
 #include "sections.h"
 #include "symbols.h"
@@ -20,6 +21,19 @@ struct objectfile;
 struct objectfile_reader;
 struct archive;
 struct archive_reader;
+struct pending_file;
+struct threadpool;
+
+
+/*
+ * Which non-loadable sections to strip from input files.
+ */
+enum linker_strip
+{
+    STRIP_NONE,     // keep all sections
+    STRIP_DEBUG,    // strip debug sections
+    STRIP_ALL       // strip debug sections and non-loadable metadata
+};
 
 
 /* 
@@ -35,6 +49,14 @@ struct linkerctx
     struct sections sections;       // worklist of input sections
     struct symbols unresolved;      // queue of unresolved symbols
     struct groups groups;           // section groups
+    const char *index_cache;        // directory for cached symbol indexes of archives without one (NULL if disabled)
+    struct pending_file **pending;  // object files waiting for their relocations to be loaded
+    uint64_t npending;              // number of pending object files
+    enum linker_strip strip;        // sections to strip from input files
+    uint64_t nobjectfiles;          // number of object files loaded
+    uint64_t nextracted;            // number of archive members extracted
+    unsigned threads;               // number of threads to use (0 for the default)
+    struct threadpool *pool;        // worker threads (created on first use)
 
     uint32_t target_march;          // target machine code architecture
     uint64_t target_ptr_size;       // pointer alignment for target machine code
@@ -102,6 +124,20 @@ bool linker_read_archive(struct linkerctx *ctx,
                          const struct archive_reader *reader);
 
 
+/*
+ * Read several archives and add the symbols they provide to the
+ * archive symbol index.
+ *
+ * The archives are parsed concurrently, each into a partial index
+ * of its own, and the partial indexes are then merged in the order
+ * the archives are given. If more than one archive provides a symbol,
+ * the first archive wins, like with repeated calls to linker_read_archive().
+ */
+bool linker_read_archives(struct linkerctx *ctx,
+                          struct archive **archives,
+                          size_t narchives);
+
+
 
 
 
@@ -130,6 +166,20 @@ bool linker_add_crt_markers(struct linkerctx *ctx);
 bool linker_resolve_globals(struct linkerctx *ctx);
 
 
+/*
+ * Load relocations for all loaded object files.
+ *
+ * Object files are loaded in two phases. The first phase, when 
+ * the file is added, only loads what is needed to resolve symbols.
+ * This is the second phase, which loads relocations of the sections 
+ * that were kept. Files are processed in parallel.
+ *
+ * This must be done after symbols are resolved and before
+ * dead code elimination.
+ */
+bool linker_load_relocations(struct linkerctx *ctx);
+
+
 /*
  * Mark reachable sections and symbols as alive.
  * Part of dead code elimination (DCE).
@@ -138,12 +188,37 @@ void linker_dce_mark(struct linkerctx *ctx, const struct symbols *keep);
 
 
 /*
- * Remove sections and symbols that aren't marked as alive.
+ * Remove sections that aren't marked as alive, and global symbols 
+ * that aren't referred to from live sections. The content of object 
+ * files that no live section is taken from is released from memory.
  * Part of dead code elimination (DCE)
  */
 void linker_dce_sweep(struct linkerctx *ctx);
 
 
+/*
+ * Print a report of global symbols that are defined in sections
+ * of their own, such as function sections (.text.name) created 
+ * with -ffunction-sections, and whether the sections were kept.
+ */
+bool linker_report_section_symbols(struct linkerctx *ctx, FILE *fp);
+
+
+/*
+ * Print hash table statistics for the global symbol index,
+ * the archive index, the string pool and the section groups.
+ */
+void linker_print_stats(const struct linkerctx *ctx, FILE *fp);
+
+
+/*
+ * Print heap memory usage per subsystem, how much of the memory-mapped
+ * input files is resident, and the resident set size of the process,
+ * after a link phase.
+ */
+void linker_print_memory_report(FILE *fp, const char *phase);
+
+
 /*
  * Create a common section.
  *
@@ -7,12 +7,28 @@ extern "C" {
 #include <stddef.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdbool.h>
 
 #define LOG_CTX_MAX 32
 
 
+/*
+ * Most verbose log level that is compiled in. Messages above this
+ * level are removed at compile time, along with their arguments.
+ * Set with the BFLD_MIN_LOG_LEVEL CMake cache variable.
+ */
+#ifndef BFLD_MIN_LOG_LEVEL
+#define BFLD_MIN_LOG_LEVEL 5
+#endif
+
+
 /*
  * Log context structure.
+ *
+ * Fields that are not set are inherited from the enclosing context
+ * when a message is emitted. Instead of a file name, a context may 
+ * have a function that provides the name, so that names are only 
+ * formatted if a message is actually emitted.
  */
 typedef struct {
     const char *file;
@@ -20,14 +36,20 @@ typedef struct {
     size_t offset;
     unsigned lineno;
     const char *name;
+    const char * (*file_name)(void *arg);
+    void *file_name_arg;
 } log_ctx_t;
 
 
 extern int log_level;
 
-extern int log_ctx;
+/*
+ * Log contexts are per thread, so that files can be
+ * read concurrently with their own log context.
+ */
+extern _Thread_local int log_ctx;
 
-extern log_ctx_t log_ctx_stack[LOG_CTX_MAX];
+extern _Thread_local log_ctx_t log_ctx_stack[LOG_CTX_MAX];
 
 
 static inline
@@ -56,30 +78,7 @@ static inline
 int log_ctx_push(log_ctx_t ctx)
 {
     if (log_ctx >= 0 && log_ctx < LOG_CTX_MAX - 1) {
-        // Copy information from the previous context
-        if (ctx.file == NULL) {
-            if (ctx.section == NULL) {
-                if (ctx.offset == 0) {
-                    if (ctx.lineno == 0) {
-                        ctx.lineno = log_ctx_stack[log_ctx].lineno;
-                    }
-                    ctx.offset = log_ctx_stack[log_ctx].offset;
-                }
-                ctx.section = log_ctx_stack[log_ctx].section;
-            }
-            ctx.file = log_ctx_stack[log_ctx].file;
-        }
-
-        // Create new context
-        log_ctx_t new_ctx = {
-            .file = ctx.file != NULL ? ctx.file : NULL,
-            .section = ctx.section != NULL ? ctx.section : NULL,
-            .offset = ctx.offset,
-            .lineno = ctx.lineno,
-            .name = ctx.name != NULL ? ctx.name : NULL
-        };
-
-        log_ctx_stack[log_ctx + 1] = new_ctx;
+        log_ctx_stack[log_ctx + 1] = ctx;
     }
     return ++log_ctx;
 }
@@ -100,6 +99,21 @@ int log_ctx_new(const char *file)
 }
 
 
+/*
+ * Create a new log context where the file name is provided 
+ * by a function, which is only called if a message is emitted.
+ */
+static inline
+int log_ctx_new_lazy(const char * (*file_name)(void*), void *arg)
+{
+    log_ctx_t new_ctx = {
+        .file_name = file_name,
+        .file_name_arg = arg,
+    };
+    return log_ctx_push(new_ctx);
+}
+
+
 #define log_ctx_safe ((log_ctx < LOG_CTX_MAX - 1) ? log_ctx : LOG_CTX_MAX - 1)
 
 #define LOG_CTX(...) ((log_ctx_t) { \
@@ -118,146 +132,72 @@ int log_ctx_new(const char *file)
 #define LOG_TRACE   5
 
 
-static inline
-void log_message_va(int level, const char *fmt, va_list ap)
-{
-    if (level <= log_level) {
-        const log_ctx_t *ctx = &log_ctx_stack[log_ctx_safe];
-
-        if (ctx->file != NULL && ctx->file[0] != '\0') {
-            fprintf(stderr, "[%s", ctx->file);
-
-            if (ctx->section != NULL) {
-                fprintf(stderr, ":%s", ctx->section);
-            }
-
-            if (ctx->offset > 0) {
-                fprintf(stderr, "+0x%zx", ctx->offset);
-            }
-
-            if (ctx->lineno > 0) {
-                fprintf(stderr, ":%u", ctx->lineno);
-            } 
-
-            if (ctx->name != NULL) {
-                fprintf(stderr, "(%s)", ctx->name);
-            }
-
-            fprintf(stderr, "] ");
-
-        } else if (ctx->section != NULL && ctx->section[0] != '\0') {
-            fprintf(stderr, "[%s", ctx->section);
-            if (ctx->name != NULL && ctx->name[0] != '\0') {
-                fprintf(stderr, "(%s)", ctx->name);
-            }
-            fprintf(stderr, "] ");
-
-        } else {
-            if (ctx->name != NULL) {
-                fprintf(stderr, "(%s) ", ctx->name);
-            }
-        }
-
-        if (level <= LOG_FATAL) {
-            fprintf(stderr, "fatal: ");
-        } else if (level == LOG_ERROR) {
-            fprintf(stderr, "error: ");
-        } else if (level == LOG_WARNING) {
-            fprintf(stderr, "warning: ");
-        } else if (level == LOG_NOTICE) {
-            fprintf(stderr, "notice: ");
-        } else if (level == LOG_INFO) {
-            fprintf(stderr, "info: ");
-        } else if (level == LOG_DEBUG) {
-            fprintf(stderr, "debug: ");
-        } else {
-            fprintf(stderr, "trace: ");
-        }
-
-        vfprintf(stderr, fmt, ap);
-        fprintf(stderr, "\n");
-    }
-}
-
-
-static inline
-void log_message(int level, const char *fmt, ...)
-{
-    va_list ap;
-    va_start(ap, fmt);
-    log_message_va(level, fmt, ap);
-    va_end(ap);
-}
-
-
-static inline
-void log_trace(const char *fmt, ...)
-{
-    va_list ap;
-    va_start(ap, fmt);
-    log_message_va(LOG_TRACE, fmt, ap);
-    va_end(ap);
-}
+/*
+ * Check if messages at the given level are emitted. 
+ * This is constant for levels that are not compiled in.
+ */
+#define log_enabled(level) ((level) <= BFLD_MIN_LOG_LEVEL && (level) <= log_level)
 
 
-static inline
-void log_debug(const char *fmt, ...)
+/*
+ * Buffer of formatted log messages.
+ */
+struct log_buffer
 {
-    va_list ap;
-    va_start(ap, fmt);
-    log_message_va(LOG_DEBUG, fmt, ap);
-    va_end(ap);
-}
+    char *data;
+    size_t size;
+    size_t capacity;
+    bool fixed;         // data is not allocated on the heap
+};
 
 
-static inline
-void log_info(const char *fmt, ...)
-{
-    va_list ap;
-    va_start(ap, fmt);
-    log_message_va(LOG_INFO, fmt, ap);
-    va_end(ap);
-}
+/*
+ * Capture messages emitted by the calling thread in the buffer,
+ * instead of writing them out. This is used to print messages
+ * from tasks that run in parallel in a deterministic order.
+ * Pass NULL to stop capturing.
+ *
+ * Returns the buffer that messages were captured in before,
+ * so that it can be restored.
+ */
+struct log_buffer * log_capture(struct log_buffer *buffer);
 
 
-static inline
-void log_notice(const char *fmt, ...)
-{
-    va_list ap;
-    va_start(ap, fmt);
-    log_message_va(LOG_NOTICE, fmt, ap);
-    va_end(ap);
-}
+/*
+ * Write out captured messages and release the buffer.
+ */
+void log_buffer_flush(struct log_buffer *buffer);
 
 
-static inline
-void log_warning(const char *fmt, ...)
-{
-    va_list ap;
-    va_start(ap, fmt);
-    log_message_va(LOG_WARNING, fmt, ap);
-    va_end(ap);
-}
+/*
+ * Emit a log message with the current log context.
+ * Use the log_* macros instead, which check the level first.
+ */
+void log_message_va(int level, const char *fmt, va_list ap);
 
 
-static inline
-void log_error(const char *fmt, ...)
-{
-    va_list ap;
-    va_start(ap, fmt);
-    log_message_va(LOG_ERROR, fmt, ap);
-    va_end(ap);
-}
+void log_emit(int level, const char *fmt, ...);
 
 
-static inline
-void log_fatal(const char *fmt, ...)
-{
-    va_list ap;
-    va_start(ap, fmt);
-    log_message_va(LOG_FATAL, fmt, ap);
-    va_end(ap);
-}
+/*
+ * Log a message. The arguments are only evaluated if
+ * the message is emitted.
+ */
+#define log_message(level, ...) \
+    do { \
+        if (log_enabled(level)) { \
+            log_emit((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+
+#define log_trace(...)      log_message(LOG_TRACE, __VA_ARGS__)
+#define log_debug(...)      log_message(LOG_DEBUG, __VA_ARGS__)
+#define log_info(...)       log_message(LOG_INFO, __VA_ARGS__)
+#define log_notice(...)     log_message(LOG_NOTICE, __VA_ARGS__)
+#define log_warning(...)    log_message(LOG_WARNING, __VA_ARGS__)
+#define log_error(...)      log_message(LOG_ERROR, __VA_ARGS__)
+#define log_fatal(...)      log_message(LOG_FATAL, __VA_ARGS__)
 
 
 #ifdef __cplusplus
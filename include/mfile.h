@@ -5,6 +5,8 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
+#include "utils/list.h"
 
 
 /*
@@ -16,7 +18,9 @@ struct mfile
     int refcnt;         // reference counter
     int fd;             // the file descriptor used to open the file
     size_t size;        // total size of the file
+    int64_t mtime;      // last modification time of the file (seconds since epoch)
     const void *data;   // memory-mapped pointer to the start of file contents
+    struct list_head list_node; // list of currently mapped files
 };
 
 
@@ -49,6 +53,29 @@ struct mfile * mfile_get(struct mfile *file);
 void mfile_put(struct mfile *file);
 
 
+/*
+ * Tell the kernel that a range of the memory mapped file is not needed 
+ * for a while, so that its pages can be dropped from the process' 
+ * resident memory. Only pages that are entirely within the range are 
+ * dropped. The content stays valid, and is read back in from the file
+ * if it is accessed again.
+ */
+void mfile_release(struct mfile *file, const void *data, size_t size);
+
+
+/*
+ * Get the total number of bytes currently memory-mapped by open files,
+ * how many of those bytes are resident in this process (mapped into its
+ * page tables, see mfile_release()), and how many are in the page cache.
+ *
+ * Pages may stay in the page cache after the process has dropped them,
+ * so only the resident figure shows released or untouched content.
+ * If the process' memory map can not be read, resident is the same 
+ * as cached.
+ */
+void mfile_residency(uint64_t *mapped, uint64_t *resident, uint64_t *cached);
+
+
 #ifdef __cplusplus
 }
 #endif
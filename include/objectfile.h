@@ -14,6 +14,7 @@ struct mfile;
 struct sections;
 struct symbols;
 struct objectfile_reader;
+struct archive;
 
 
 /*
@@ -23,11 +24,15 @@ struct objectfile_reader;
  */
 struct objectfile
 {
-    char *name;                 // name of the object file
+    char *name;                 // name of the object file (formatted on demand for archive members)
+    struct archive *archive;    // strong reference to the archive if the file is an archive member (NULL otherwise)
+    size_t member;              // offset to the archive member
     struct mfile *file;         // strong reference to the underlying memory mapped file
     int refcnt;                 // reference counter
     const uint8_t *file_data;   // pointer to the start of the file
     size_t file_size;           // total size of the file
+    bool has_live_sections;     // set by DCE if any section from the file is kept
+    bool is_released;           // has the file content been released from memory?
 };
 
 
@@ -45,6 +50,28 @@ struct objectfile * objectfile_alloc(struct mfile *file,
                                      const uint8_t *file_data,
                                      size_t file_size);
 
+/*
+ * Allocate an object file handle for an archive member.
+ *
+ * This takes a strong reference to the archive, and the object file 
+ * is identified by the archive and the member offset. The name is 
+ * only formatted if it is asked for, see objectfile_name().
+ */
+struct objectfile * objectfile_alloc_member(struct archive *archive,
+                                            size_t member,
+                                            const uint8_t *file_data,
+                                            size_t file_size);
+
+
+/*
+ * Get the name of the object file.
+ *
+ * For archive members, the name is formatted as "archive(member)"
+ * the first time it is needed.
+ */
+const char * objectfile_name(struct objectfile *file);
+
+
 /*
  * Take a strong object file handle reference.
  * Increases the object file handle's reference counter.
@@ -61,6 +88,14 @@ struct objectfile * objectfile_get(struct objectfile *file);
 void objectfile_put(struct objectfile *file);
 
 
+/*
+ * Release the object file content from memory once nothing is going
+ * to read it anymore, see mfile_release(). The content is still valid,
+ * and is read back in from the file if it is accessed again.
+ */
+void objectfile_release_content(struct objectfile *file);
+
+
 /*
  * Load sections and symbols from an object file.
  *
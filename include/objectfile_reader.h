@@ -45,7 +45,17 @@ struct objectfile_reader
     bool (*probe_file)(const uint8_t *file_data, size_t file_size, uint32_t *march);
 
     /*
-     * Parse file data and load sections and symbols.
+     * Parse file data and load sections, section groups and 
+     * global symbols (first phase).
+     *
+     * This is all that is needed for symbol resolution. Relocations 
+     * are loaded later by parse_relocs, but front-ends that do not 
+     * implement it may add relocations to the sections here.
+     *
+     * The front-end may set state to a private handle for the file,
+     * for example the validated file headers, which is handed to
+     * parse_relocs so that the file does not have to be validated 
+     * again. The handle is released with release_state.
      *
      * If this function returns anything but 0, it is assumed
      * to mean that a fatal error occurred and parsing is aborted.
@@ -55,10 +65,74 @@ struct objectfile_reader
                       size_t file_size,
                       struct groups *groups,
                       struct section_table *sections,
-                      struct symbol_table *symbols);
+                      struct symbol_table *symbols,
+                      void **state);
+
+    /*
+     * Parse relocations for the sections that are kept (second phase).
+     *
+     * This is called after symbol resolution, with a section table 
+     * holding the sections from the first phase that were not 
+     * discarded, and a symbol table holding the resolved global 
+     * symbols, both indexed like in the file. Relocations for
+     * sections not in the section table are skipped. Local symbols 
+     * that relocations refer to are created and added to the
+     * symbol table.
+     *
+     * The state is the handle set by parse_file for the same file.
+     *
+     * This operation is optional. It may be called concurrently 
+     * for different files.
+     */
+    int (*parse_relocs)(void *state,
+                        struct section_table *sections,
+                        struct symbol_table *symbols);
+
+    /*
+     * Release the private handle set by parse_file.
+     * This operation is optional.
+     */
+    void (*release_state)(void *state);
+
+    /*
+     * Report the names of global symbols defined in the file,
+     * without loading sections and symbols.
+     *
+     * This is used to index archive members when the archive does
+     * not have a symbol index. The define callback returns false
+     * if the name could not be recorded, which aborts scanning.
+     *
+     * This operation is optional, and must be safe to call
+     * concurrently for different files.
+     */
+    int (*scan_globals)(const uint8_t *file_data,
+                        size_t file_size,
+                        bool (*define)(void *arg, const char *name),
+                        void *arg);
 };
 
 
+/*
+ * Check if a COMDAT section group with the given signature is already
+ * loaded from another object file.
+ *
+ * Front-ends can use this to skip sections belonging to duplicate
+ * groups, instead of loading them only to have them discarded.
+ */
+bool linker_is_group_loaded(const struct linkerctx *ctx, const char *signature);
+
+
+/*
+ * Check if sections of the given type should be stripped.
+ *
+ * Front-ends should not create stripped sections, nor parse their
+ * relocations, as they would never make it into the output.
+ */
+bool linker_is_section_stripped(const struct linkerctx *ctx, 
+                                enum section_type type, 
+                                bool alloc);
+
+
 /*
  * Register an object file front-end.
  *
@@ -16,6 +16,7 @@ extern "C" {
 struct linkerctx;
 struct objectfile;
 struct symbol;
+struct symbols;
 
 
 /* 
@@ -64,6 +65,7 @@ struct reloc
     uint64_t offset;                // offset within section to where the relocation should be applied
     struct symbol *symbol;          // strong reference to the symbol the relocation refers to
     uint32_t type;                  // relocation type, which kind of "patch" to apply
+    uint32_t symidx;                // index of the symbol in the object file's symbol table
     int64_t addend;                 // relocation addend
 };
 
@@ -109,10 +111,15 @@ void section_put(struct section *section);
 /*
  * Add a relocation to the section's relocation list.
  * This will take a strong reference to the symbol.
+ *
+ * The symbol index is the index of the symbol in the object
+ * file's symbol table, and is used to replace the symbol with
+ * the resolved global symbol once the file is loaded.
  */
 struct reloc * section_add_reloc(struct section *section, 
                                  uint64_t offset, 
                                  struct symbol *symbol,
+                                 uint32_t symidx,
                                  uint32_t type,
                                  int64_t addend);
 
@@ -131,6 +138,19 @@ void section_remove_reloc(struct reloc *reloc);
 void section_clear_relocs(struct section *section);
 
 
+/*
+ * Clear all relocations from the section's relocation list, but
+ * instead of releasing the last reference to a symbol (which frees
+ * the symbol and may release the section it is defined in), move
+ * the reference to the deferred queue.
+ *
+ * Different sections can be cleared concurrently this way, as long 
+ * as every thread uses its own deferred queue. Clearing the queue 
+ * afterwards releases the symbols.
+ */
+void section_clear_relocs_deferred(struct section *section, struct symbols *deferred);
+
+
 /*
  * Duplicate a section and its relocations.
  *
@@ -10,6 +10,7 @@ extern "C" {
 #include <string.h>
 #include <assert.h>
 #include "utils/hash.h"
+#include "tablestats.h"
 
 
 /*
@@ -57,6 +58,7 @@ struct strpool
     uint64_t capacity;          // capacity of the index (must be power of 2)
     struct strintern *index;    // hash table
     uint64_t rehash_threshold;  // threshold for when to expand and rehash (current capacity * load factor)
+    struct table_stats stats;   // hash table statistics
 };
 
 
@@ -99,6 +101,12 @@ bool strpool_extend(struct strpool *pool, size_t size);
 bool strpool_rehash(struct strpool *pool, uint64_t capacity);
 
 
+/*
+ * Get statistics for the string pool's hash table.
+ */
+void strpool_table_stats(const struct strpool *pool, struct table_stats *stats);
+
+
 /*
  * Append a string with a given length to the underlying string table.
  *
@@ -161,12 +169,15 @@ uint64_t strpool_intern(struct strpool *pool, const char *string)
                 uint64_t offset = pool->index[slot].offset;
                 const char *value = &pool->strings[offset];
                 if (strcmp(string, value) == 0) {
+                    table_stats_lookup(&pool->stats, true, dfi + 1);
                     return offset;
                 }
             }
             slot = (slot + 1) & mask;
             ++dfi;
         }
+
+        table_stats_lookup(&pool->stats, false, dfi + 1);
     }
 
     // Resize and rehash if we need to
@@ -303,6 +314,7 @@ uint64_t strpool_lookup(const struct strpool *pool, const char *string)
         if (this->hash == hash) {
             const char *value = &pool->strings[this->offset];
             if (strcmp(string, value) == 0) {
+                table_stats_lookup(&pool->stats, true, dfi + 1);
                 return this->offset;
             }
         }
@@ -312,6 +324,7 @@ uint64_t strpool_lookup(const struct strpool *pool, const char *string)
         ++dfi;
     }
 
+    table_stats_lookup(&pool->stats, false, dfi + 1);
     return 0;
 }
 
@@ -62,7 +62,7 @@ struct symbol
 {
     int refcnt;                     // reference counter
     uint32_t hash;                  // precalculated hash of the symbol name
-    struct strpool *strings;        // global string pool reference
+    struct strpool *strings;        // string pool reference (global pool, or the object file's pool for local symbols)
     uint64_t name_id;               // name identifier
     enum symbol_binding binding;    // symbol binding type
     enum symbol_type type;          // symbol type
@@ -70,6 +70,7 @@ struct symbol
     uint64_t size;                  // symbol size
     bool is_absolute;               // is the definition offset relative to a section base address or an absolute address
     bool is_common;                 // does the symbol refer to a common section?
+    bool is_used;                   // is the symbol a DCE root or referenced from a live section?
     enum symbol_export visibility;  // symbol visibility
     struct section *section;        // strong reference to the section where the symbol is defined
     uint64_t offset;                // offset into the section to the definition or absolute address
@@ -100,24 +101,21 @@ bool symbol_is_defined(const struct symbol *symbol)
 
 /*
  * Helper function to determine if a symbol is "alive".
+ *
+ * After dead code elimination (DCE), a symbol is alive if it is one of 
+ * the roots or a relocation in a live section refers to it. Symbols that 
+ * are defined in live sections, but are never referred to, are dead.
  */
 static inline
 bool symbol_is_alive(const struct symbol *symbol)
 {
-    if (symbol->is_absolute) {
-        return true;
-    }
-
-    if (symbol->section != NULL && symbol->section->is_alive) {
-        return true;
-    }
-
-    return false;
+    return symbol->is_used;
 }
 
 
 /*
  * Allocate a symbol descriptor.
+ * The symbol name is interned in the linker's global string pool.
  */
 struct symbol * symbol_alloc(const struct linkerctx *ctx,
                              const char *name,
@@ -125,6 +123,19 @@ struct symbol * symbol_alloc(const struct linkerctx *ctx,
                              enum symbol_binding binding);
 
 
+/*
+ * Allocate a symbol descriptor with the name interned in 
+ * the specified string pool. This is used for local symbols,
+ * which should not be added to the global string pool.
+ *
+ * Note that this takes a reference to the string pool.
+ */
+struct symbol * symbol_alloc_strings(struct strpool *strings,
+                                     const char *name,
+                                     enum symbol_type type,
+                                     enum symbol_binding binding);
+
+
 /*
  * Increase symbol descriptor's reference counter.
  */
@@ -140,6 +151,17 @@ struct symbol * symbol_get(struct symbol *symbol);
 void symbol_put(struct symbol *symbol);
 
 
+/*
+ * Release a symbol reference, unless it is the last reference.
+ * Returns true if the reference was released, or false if the caller
+ * holds the last reference and must release it with symbol_put().
+ *
+ * This lets threads drop references concurrently while leaving
+ * the release of the symbol itself to a single thread.
+ */
+bool symbol_put_unless_last(struct symbol *symbol);
+
+
 /*
  * Undefine a symbol.
  */
@@ -0,0 +1,69 @@
+#ifndef BFLD_TABLE_STATS_H
+#define BFLD_TABLE_STATS_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Hash table statistics.
+ *
+ * The counters are kept by the hash tables at all times, and
+ * are cheap to update. The shape of the table (capacity, entries
+ * and distances from ideal slots) is filled in by scanning the
+ * table when statistics are requested.
+ */
+struct table_stats
+{
+    uint64_t capacity;      // number of slots
+    uint64_t entries;       // number of entries
+    uint64_t max_dfi;       // longest distance from ideal slot
+    uint64_t total_dfi;     // sum of distances from ideal slot of all entries
+    uint64_t rehashes;      // number of times the table was grown and rehashed
+    uint64_t hits;          // lookups that found an entry
+    uint64_t misses;        // lookups that did not find an entry
+    uint64_t probes;        // slots visited by lookups
+};
+
+
+/*
+ * Count a lookup.
+ *
+ * Lookups are done through const pointers to the table, as they do 
+ * not modify its contents. The counters are the only exception, and 
+ * are updated atomically since a table may be looked up from several 
+ * threads at the same time.
+ */
+static inline
+void table_stats_lookup(const struct table_stats *stats, bool hit, uint64_t probes)
+{
+    struct table_stats *counters = (struct table_stats*) stats;
+
+    __atomic_fetch_add(hit ? &counters->hits : &counters->misses, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&counters->probes, probes, __ATOMIC_RELAXED);
+}
+
+
+/*
+ * Add an entry with the given distance from its ideal slot
+ * when scanning a table.
+ */
+static inline
+void table_stats_entry(struct table_stats *stats, uint64_t dfi)
+{
+    stats->entries++;
+    stats->total_dfi += dfi;
+    if (dfi > stats->max_dfi) {
+        stats->max_dfi = dfi;
+    }
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,95 @@
+#ifndef BFLD_TIME_REPORT_H
+#define BFLD_TIME_REPORT_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+
+/*
+ * Forward declaration of linker context.
+ */
+struct linkerctx;
+
+
+/*
+ * Output formats for time reports.
+ */
+enum time_report_format
+{
+    TIME_REPORT_TEXT,
+    TIME_REPORT_JSON
+};
+
+
+/*
+ * Resource usage at a point in time.
+ */
+struct time_sample
+{
+    uint64_t wall_ns;           // monotonic wall clock time
+    uint64_t cpu_ns;            // CPU time of all threads in the process
+    uint64_t max_rss_kb;        // peak resident set size
+};
+
+
+/*
+ * Timing and item counts of a link phase.
+ */
+struct time_phase
+{
+    const char *name;           // name of the phase
+    struct time_sample start;   // resource usage when the phase started
+    struct time_sample end;     // resource usage when the phase ended
+    uint64_t files;             // object files loaded at the end of the phase
+    uint64_t extracted;         // archive members extracted at the end of the phase
+    uint64_t sections;          // input sections at the end of the phase
+    uint64_t symbols;           // global symbols at the end of the phase
+    uint64_t relocations;       // relocations of input sections at the end of the phase
+};
+
+
+/*
+ * Time report of link phases.
+ */
+struct time_report
+{
+    struct time_phase *phases;  // phases in the order they were run
+    size_t nphases;             // number of phases
+    size_t capacity;            // capacity of the phases array
+};
+
+
+/*
+ * Start timing a phase. The name must outlive the report.
+ */
+bool time_report_begin(struct time_report *report, const char *name);
+
+
+/*
+ * Stop timing the current phase and record item counts
+ * from the linker context.
+ */
+void time_report_end(struct time_report *report, const struct linkerctx *ctx);
+
+
+/*
+ * Print the time report.
+ */
+void time_report_print(const struct time_report *report, FILE *fp, enum time_report_format format);
+
+
+/*
+ * Release resources held by the time report.
+ */
+void time_report_clear(struct time_report *report);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
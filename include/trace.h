@@ -0,0 +1,94 @@
+#ifndef BFLD_TRACE_H
+#define BFLD_TRACE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Timeline tracing.
+ *
+ * Spans of work are recorded with the thread that did them, and
+ * written as trace event JSON that can be opened in chrome://tracing
+ * or Perfetto. Tracing is disabled unless a trace file is opened, and
+ * a disabled span costs a single branch.
+ */
+
+
+/*
+ * Is tracing enabled? Only set by trace_open().
+ */
+extern bool trace_enabled;
+
+
+/*
+ * A span of work in progress.
+ */
+struct trace_span
+{
+    const char *name;   // name of the span (must be a string literal)
+    uint64_t start;     // start time in nanoseconds (0 if tracing is disabled)
+};
+
+
+/*
+ * Enable tracing. The trace is written to the given file by trace_close().
+ */
+bool trace_open(const char *pathname);
+
+
+/*
+ * Write the trace file and disable tracing.
+ * Must not be called while spans are in progress on other threads.
+ */
+void trace_close(void);
+
+
+/*
+ * Get current time for a span.
+ */
+uint64_t trace_clock(void);
+
+
+/*
+ * Start a span of work.
+ */
+static inline
+struct trace_span trace_begin(const char *name)
+{
+    struct trace_span span = {
+        .name = name,
+        .start = trace_enabled ? trace_clock() : 0
+    };
+    return span;
+}
+
+
+/*
+ * Record a completed span of work, optionally with a detail, 
+ * such as the name of the file that was processed. The detail
+ * is copied.
+ */
+void trace_record(const struct trace_span *span, const char *detail);
+
+
+/*
+ * End a span of work.
+ */
+static inline
+void trace_end(const struct trace_span *span, const char *detail)
+{
+    if (span->start != 0) {
+        trace_record(span, detail);
+    }
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
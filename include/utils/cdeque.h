@@ -0,0 +1,118 @@
+#ifndef BFLD_UTILS_CONCURRENT_DEQUE_H
+#define BFLD_UTILS_CONCURRENT_DEQUE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*
+ * Concurrent double-ended queue (Chase-Lev work-stealing deque).
+ *
+ * One thread owns the deque and pushes and pops entries at the back,
+ * like a LIFO stack. Any number of other threads may concurrently pop
+ * entries from the front, which is how idle workers steal the oldest
+ * work from a busy worker. Pushing and popping are lock-free.
+ *
+ * The owner is whichever thread pushes and pops at the back; it is up
+ * to the user to make sure there is only one at a time. Entries can not
+ * be NULL, since NULL is returned when the deque is empty.
+ *
+ * The buffer grows like the buffer of struct deque, but since threads
+ * popping at the front may still be reading the old buffer, old buffers
+ * are kept until the deque is cleared. They add up to less than the
+ * size of the current buffer.
+ */
+struct cdeque
+{
+    int64_t top __attribute__((aligned(64)));       // front, advanced by poppers
+    int64_t bottom __attribute__((aligned(64)));    // back, only moved by the owner
+    struct cdeque_buffer *buffer;
+};
+
+
+/*
+ * Initialize an empty concurrent deque.
+ */
+#define CDEQUE_INIT (struct cdeque) {0, 0, NULL}
+
+
+/*
+ * Initialize an empty concurrent deque.
+ */
+static inline
+void cdeque_init(struct cdeque *d)
+{
+    d->top = 0;
+    d->bottom = 0;
+    d->buffer = NULL;
+}
+
+
+/*
+ * Clear the deque and free the buffers.
+ * No other threads may use the deque at the same time.
+ */
+void cdeque_clear(struct cdeque *d);
+
+
+/*
+ * Reserve space in the deque buffer. Only called by the owner.
+ * Returns true if the deque is able to hold at least capacity
+ * entries, and false otherwise.
+ */
+bool cdeque_reserve(struct cdeque *d, uint64_t capacity);
+
+
+/*
+ * Push an entry to the back of the deque. Only called by the owner.
+ * Returns true if the entry was inserted, and false otherwise.
+ */
+bool cdeque_push_back(struct cdeque *d, void *entry);
+
+
+/*
+ * Pop the entry at the back of the deque (the most recently pushed).
+ * Only called by the owner. Returns NULL if the deque is empty.
+ */
+void * cdeque_pop_back(struct cdeque *d);
+
+
+/*
+ * Pop the entry at the front of the deque (the least recently pushed).
+ * May be called by any thread. Returns NULL if the deque is empty.
+ */
+void * cdeque_pop_front(struct cdeque *d);
+
+
+/*
+ * Get the number of entries in the deque. If other threads
+ * use the deque at the same time, this is only a snapshot.
+ */
+static inline
+uint64_t cdeque_size(const struct cdeque *d)
+{
+    int64_t bottom = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+    return bottom > top ? (uint64_t) (bottom - top) : 0;
+}
+
+
+/*
+ * Check if the deque is empty. If other threads use
+ * the deque at the same time, this is only a snapshot.
+ */
+static inline
+bool cdeque_empty(const struct cdeque *d)
+{
+    return cdeque_size(d) == 0;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
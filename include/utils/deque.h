@@ -217,6 +217,30 @@ void * deque_tail(const struct deque *d)
 }
 
 
+/*
+ * Replace the entry at the given position relative to the head/first entry.
+ * The position must be less than the size of the deque.
+ */
+static inline
+void deque_set(struct deque *d, uint64_t position, void *entry)
+{
+    d->q[(d->head + position) & (d->capacity - 1)] = entry;
+}
+
+
+/*
+ * Remove entries from the back of the deque until it holds at most 
+ * size entries. The removed entries are not returned.
+ */
+static inline
+void deque_truncate(struct deque *d, uint64_t size)
+{
+    if (size < d->size) {
+        d->size = size;
+    }
+}
+
+
 /*
  * Peek at the entry at the given position relative to the head/first entry.
  */
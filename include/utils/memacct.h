@@ -0,0 +1,123 @@
+#ifndef BFLD_UTILS_MEMORY_ACCOUNTING_H
+#define BFLD_UTILS_MEMORY_ACCOUNTING_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+
+/*
+ * Memory accounting.
+ *
+ * Heap allocations made through these functions are tagged with the
+ * subsystem they belong to, and live and peak bytes and object counts 
+ * are kept per tag. Sizes are what the allocator actually handed out
+ * (malloc_usable_size), so that allocator rounding is included.
+ *
+ * Memory accounting is compiled out if BFLD_MEMACCT is 0, in which
+ * case the functions are plain malloc, calloc, realloc and free.
+ */
+#ifndef BFLD_MEMACCT
+#if defined(__GLIBC__)
+#define BFLD_MEMACCT 1
+#else
+#define BFLD_MEMACCT 0
+#endif
+#endif
+
+
+/*
+ * Memory accounting tags.
+ */
+enum memacct_tag
+{
+    MEMACCT_OTHER,
+    MEMACCT_SECTIONS,   // section descriptors
+    MEMACCT_RELOCS,     // relocation entries
+    MEMACCT_SYMBOLS,    // symbol descriptors
+    MEMACCT_STRINGS,    // string pools
+    MEMACCT_ARCHIVES,   // archive symbol indexes
+    MEMACCT_GLOBALS,    // global symbol index
+    MEMACCT_DEQUE,      // deques (queues of sections and symbols)
+    MEMACCT_TABLE,      // tables (section and symbol tables of input files)
+    MEMACCT_NTAGS
+};
+
+
+/*
+ * Memory usage for a tag.
+ */
+struct memacct_stats
+{
+    uint64_t live_bytes;    // bytes currently allocated
+    uint64_t peak_bytes;    // highest number of bytes allocated at any time
+    uint64_t live_objects;  // allocations currently live
+    uint64_t peak_objects;  // highest number of live allocations at any time
+    uint64_t allocs;        // total number of allocations
+};
+
+
+#if BFLD_MEMACCT
+
+void * memacct_malloc(enum memacct_tag tag, size_t size);
+
+void * memacct_calloc(enum memacct_tag tag, size_t nmemb, size_t size);
+
+void * memacct_realloc(enum memacct_tag tag, void *ptr, size_t size);
+
+void memacct_free(enum memacct_tag tag, void *ptr);
+
+#else
+
+static inline
+void * memacct_malloc(enum memacct_tag tag, size_t size)
+{
+    (void) tag;
+    return malloc(size);
+}
+
+static inline
+void * memacct_calloc(enum memacct_tag tag, size_t nmemb, size_t size)
+{
+    (void) tag;
+    return calloc(nmemb, size);
+}
+
+static inline
+void * memacct_realloc(enum memacct_tag tag, void *ptr, size_t size)
+{
+    (void) tag;
+    return realloc(ptr, size);
+}
+
+static inline
+void memacct_free(enum memacct_tag tag, void *ptr)
+{
+    (void) tag;
+    free(ptr);
+}
+
+#endif
+
+
+/*
+ * Get the memory usage of a tag.
+ * All counters are zero if memory accounting is compiled out.
+ */
+void memacct_get_stats(enum memacct_tag tag, struct memacct_stats *stats);
+
+
+/*
+ * Get the name of a tag.
+ */
+const char * memacct_tag_name(enum memacct_tag tag);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
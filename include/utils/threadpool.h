@@ -0,0 +1,124 @@
+#ifndef BFLD_UTILS_THREADPOOL_H
+#define BFLD_UTILS_THREADPOOL_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Work-stealing thread pool.
+ *
+ * Every worker has a Chase-Lev deque of tasks (see cdeque.h). A worker
+ * pushes and pops tasks it spawns at the back of its own deque (LIFO),
+ * while idle workers steal from the front of other workers' deques (FIFO).
+ * Workers that find nothing to do spin for a little while and then
+ * go to sleep until new tasks are spawned.
+ *
+ * Worker 0 is not a background thread, but the thread that allocated
+ * the pool. It takes part in the work while it waits for tasks to
+ * complete. Only the thread that allocated the pool, and the pool's
+ * own workers, may spawn tasks and wait for them.
+ */
+struct threadpool;
+
+
+/*
+ * Group of tasks that can be waited for.
+ */
+struct task_group
+{
+    struct threadpool *pool;
+    uint64_t pending;           // number of spawned tasks that have not completed
+};
+
+
+/*
+ * Get the default number of threads to use. This is the value of
+ * the BFLD_THREADS environment variable if it is set, and the
+ * number of online CPUs otherwise.
+ */
+unsigned threadpool_default_threads(void);
+
+
+/*
+ * Create a thread pool with nthreads workers, including the calling
+ * thread. If nthreads is 0, threadpool_default_threads() is used.
+ * If nthreads is 1, no threads are started and all tasks run on
+ * the calling thread.
+ *
+ * Returns NULL if the pool could not be created.
+ */
+struct threadpool * threadpool_alloc(unsigned nthreads);
+
+
+/*
+ * Stop the worker threads and release the thread pool.
+ * There must be no tasks left.
+ */
+void threadpool_free(struct threadpool *pool);
+
+
+/*
+ * Get the number of workers in the pool, including the thread
+ * that allocated it.
+ */
+unsigned threadpool_size(const struct threadpool *pool);
+
+
+/*
+ * Get the index of the calling thread in the pool, in the range
+ * [0, threadpool_size()). This can be used to index per-worker
+ * state in tasks.
+ */
+unsigned threadpool_worker_index(const struct threadpool *pool);
+
+
+/*
+ * Initialize an empty task group. If pool is NULL,
+ * tasks are run immediately when they are spawned.
+ */
+static inline
+void task_group_init(struct task_group *group, struct threadpool *pool)
+{
+    group->pool = pool;
+    group->pending = 0;
+}
+
+
+/*
+ * Spawn a task in the group. The task may run on any worker.
+ * If memory for the task can not be allocated, it is run
+ * immediately on the calling thread.
+ */
+void task_group_spawn(struct task_group *group, void (*func)(void *data), void *data);
+
+
+/*
+ * Wait for all tasks in the group to complete, including tasks
+ * spawned by tasks in the group. The calling thread runs tasks
+ * while it waits.
+ */
+void task_group_wait(struct task_group *group);
+
+
+/*
+ * Call func for every index in [0, n) and wait for all calls to
+ * complete. The range is split in halves until chunks have at most
+ * grain indexes, and chunks are spread across workers by stealing.
+ * If grain is 0, a grain size is picked based on n and the number
+ * of workers.
+ *
+ * If pool is NULL, everything runs on the calling thread.
+ */
+void threadpool_parallel_for(struct threadpool *pool, uint64_t n, uint64_t grain,
+                             void (*func)(void *data, uint64_t idx), void *data);
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
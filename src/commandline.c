@@ -7,6 +7,8 @@
 #include <getopt.h>
 #include <assert.h>
 #include <logging.h>
+#include <linker.h>
+#include <timereport.h>
 #include "commandline.h"
 
 
@@ -167,12 +169,21 @@ int parse_args(int argc, char **argv, struct bfld_options *opts)
         {"entry", required_argument, 0, 'e'},
         {"show-symbols", no_argument, &opts->show_symbols, 1},
         {"show-layout", no_argument, &opts->show_layout, 1},
+        {"report-section-symbols", no_argument, &opts->report_section_symbols, 1},
+        {"time-report", optional_argument, 0, 'T'},
+        {"stats", no_argument, &opts->stats, 1},
+        {"memory-report", no_argument, &opts->memory_report, 1},
+        {"trace", required_argument, 0, 'R'},
+        {"threads", required_argument, 0, 'j'},
         {"gc-sections", no_argument, &opts->gc_sections, 1},
         {"no-gc-sections", no_argument, &opts->gc_sections, 0},
+        {"index-cache", required_argument, 0, 'C'},
+        {"strip-debug", no_argument, 0, 'S'},
+        {"strip-all", no_argument, 0, 's'},
         {0, 0, 0, 0}
     };
 
-    while ((c = getopt_long_only(argc, argv, ":hvo:e:", options, &idx)) != -1) {
+    while ((c = getopt_long_only(argc, argv, ":hvo:e:sS", options, &idx)) != -1) {
         switch (c) {
 
             case 0:
@@ -186,6 +197,47 @@ int parse_args(int argc, char **argv, struct bfld_options *opts)
                 opts->entry = optarg;
                 break;
 
+            case 'C':
+                opts->index_cache = optarg;
+                break;
+
+            case 'R':
+                opts->trace = optarg;
+                break;
+
+            case 'j': {
+                char *endptr = NULL;
+                unsigned long threads = strtoul(optarg, &endptr, 10);
+                if (*optarg == '\0' || *endptr != '\0' || threads == 0) {
+                    log_error("Invalid number of threads: '%s'", optarg);
+                    return -1;
+                }
+                opts->threads = threads;
+                break;
+            }
+
+            case 'T':
+                opts->time_report = 1;
+                if (optarg == NULL || strcmp(optarg, "text") == 0) {
+                    opts->time_report_format = TIME_REPORT_TEXT;
+                } else if (strcmp(optarg, "json") == 0) {
+                    opts->time_report_format = TIME_REPORT_JSON;
+                } else {
+                    log_error("Invalid time report format: '%s'", optarg);
+                    return -1;
+                }
+                break;
+
+            case 'S':
+                if (opts->strip < STRIP_DEBUG) {
+                    opts->strip = STRIP_DEBUG;
+                }
+                break;
+
+            case 's':
+                opts->strip = STRIP_ALL;
+                break;
+
             case 'v':
                 if (optarg == NULL) {
                     ++log_level;
@@ -208,8 +260,17 @@ int parse_args(int argc, char **argv, struct bfld_options *opts)
                 print_option(stdout, "-o", "--output", required_argument, "FILE", "Set output file name.");
                 print_option(stdout, "-e", "--entry", required_argument, "ADDRESS", "Set start address.");
                 print_option(stdout, "--[no-]gc-sections", NULL, no_argument, NULL, "Enable or disable garbage collection of dead code (default is to garbage collect).");
+                print_option(stdout, "--index-cache", NULL, required_argument, "DIR", "Cache symbol indexes built for archives without one in directory.");
+                print_option(stdout, "-S", "--strip-debug", no_argument, NULL, "Do not load debug sections from input files.");
+                print_option(stdout, "-s", "--strip-all", no_argument, NULL, "Do not load debug sections or other non-loadable metadata from input files.");
                 print_option(stdout, "--show-symbols", NULL, no_argument, NULL, "Print global symbol table.");
                 print_option(stdout, "--show-layout", NULL, no_argument, NULL, "Print image layout information.");
+                print_option(stdout, "--time-report", NULL, optional_argument, "FORMAT", "Print time and resource usage of every link phase, as text (default) or json.");
+                print_option(stdout, "--threads", NULL, required_argument, "N", "Use N threads (default is BFLD_THREADS or the number of CPUs).");
+                print_option(stdout, "--trace", NULL, required_argument, "FILE", "Write a timeline of the link as trace event JSON (chrome://tracing or Perfetto).");
+                print_option(stdout, "--stats", NULL, no_argument, NULL, "Print hash table statistics (to standard error).");
+                print_option(stdout, "--memory-report", NULL, no_argument, NULL, "Print memory usage per subsystem after each link phase (to standard error).");
+                print_option(stdout, "--report-section-symbols", NULL, no_argument, NULL, "Print global symbols that are defined in sections of their own.");
                 return 0;
 
             case ':':
@@ -15,6 +15,15 @@ struct bfld_options
     int show_symbols;
     int show_layout;
     int gc_sections;
+    int report_section_symbols;
+    int time_report;
+    int time_report_format;
+    int stats;
+    int memory_report;
+    const char *trace;
+    const char *index_cache;
+    int strip;
+    unsigned threads;
 };
 
 
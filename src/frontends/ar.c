@@ -390,39 +390,38 @@ static int parse_file(const uint8_t *ptr, size_t size,
                 log_warning("Multiple extended string tables detected");
             }
 
-        } else {
+        } else if (check_bsd_name(hdr)) {
             size_t len = member_name_length(hdr, strtab);
             char name[len + 1];
             member_name_string(hdr, strtab, name, len+1);
 
-            if (check_bsd_name(hdr)) {
-                if (strcmp(name, "__.SYMDEF_64") == 0) {
-                    log_trace("Found BSD style ranlib symbol index at offset %zu", offset);
-
-                    if (ranlib == NULL) {
-                        ranlib = hdr;
-                        ransize = membsz;
-                    } else {
-                        log_warning("Multiple ranlib symbol indexes detected");
-                    }
-
-                } else if (strcmp(name, "__.SYMDEF") == 0) {
-                    log_trace("Found BSD style ranlib symbol index at offset %zu", offset);
-
-                    if (ranlib == NULL) {
-                        ranlib = hdr;
-                        ransize = membsz;
-                    } else {
-                        log_warning("Multiple ranlib symbol indexes detected");
-                    }
+            if (strcmp(name, "__.SYMDEF_64") == 0) {
+                log_trace("Found BSD style ranlib symbol index at offset %zu", offset);
+
+                if (ranlib == NULL) {
+                    ranlib = hdr;
+                    ransize = membsz;
+                } else {
+                    log_warning("Multiple ranlib symbol indexes detected");
+                }
+
+            } else if (strcmp(name, "__.SYMDEF") == 0) {
+                log_trace("Found BSD style ranlib symbol index at offset %zu", offset);
+
+                if (ranlib == NULL) {
+                    ranlib = hdr;
+                    ransize = membsz;
                 } else {
-                    // Regular archive member
-                    archive_add_member(archive, name, offset + sizeof(*hdr) + len, membsz - len);
+                    log_warning("Multiple ranlib symbol indexes detected");
                 }
             } else {
-                // Regular archive member
-                archive_add_member(archive, name, offset + sizeof(*hdr), membsz);
+                // Regular archive member with the name stored in front of the content
+                archive_add_member(archive, offset, offset + sizeof(*hdr) + len, membsz - len);
             }
+
+        } else {
+            // Regular archive member, the name is looked up if it is needed
+            archive_add_member(archive, offset, offset + sizeof(*hdr), membsz);
         }
 
         offset += sizeof(*hdr) + membsz;
@@ -430,9 +429,11 @@ static int parse_file(const uint8_t *ptr, size_t size,
     }
 
     if (ranlib == NULL) {
-        log_warning("Archive has no symbol index");
+        log_debug("Archive has no symbol index");
         return 0;
     }
+
+    archive->has_symbol_index = true;
     
     if (ransize == 0) {
         log_warning("Archive symbol index is empty");
@@ -462,10 +463,54 @@ static int parse_file(const uint8_t *ptr, size_t size,
 }
 
 
+/*
+ * Look up the name of an archive member.
+ *
+ * The GNU/SysV extended string table always comes before regular
+ * members, so only the special members in the beginning of the 
+ * archive must be looked at to find it.
+ */
+static size_t lookup_member_name(const uint8_t *ptr, size_t size, size_t header, char *name, size_t len)
+{
+    const struct ar_header *strtab = NULL;
+    size_t offset = AR_MAGIC_SIZE;
+
+    if (header >= size || size - header < sizeof(struct ar_header)) {
+        return 0;
+    }
+
+    const struct ar_header *hdr = (const void*) (ptr + header);
+
+    if (hdr->name[0] == '/' && hdr->name[1] >= '0' && hdr->name[1] <= '9') {
+        while (offset < header && size - offset >= sizeof(struct ar_header)) {
+            const struct ar_header *special = (const void*) (ptr + offset);
+
+            if (strncmp(special->name, "//", 2) == 0) {
+                strtab = special;
+                break;
+            } else if (special->name[0] != '/') {
+                break;
+            }
+
+            offset += sizeof(struct ar_header) + member_size(special);
+            offset += offset % 2;
+        }
+    }
+
+    size_t namelen = member_name_length(hdr, strtab);
+    if (namelen > 0 && len > 0) {
+        member_name_string(hdr, strtab, name, len);
+    }
+
+    return namelen;
+}
+
+
 const struct archive_reader linux_ar_fe = {
     .name = "ar",
     .probe_file = check_magic,
     .parse_file = parse_file,
+    .member_name = lookup_member_name,
 };
 
 
@@ -60,13 +60,45 @@ static bool check_elf_header(const uint8_t *file_data, size_t file_size, uint32_
 }
 
 
+/*
+ * Per-file context holding the section header table and the base
+ * pointers of the string and symbol tables.
+ *
+ * All ranges are validated once by elf_file_open(), so the accessors 
+ * below do not need to check anything.
+ */
+struct elf_file
+{
+    const uint8_t *data;            // file content
+    size_t size;                    // file size
+    const Elf64_Ehdr *eh;           // ELF header
+    const Elf64_Shdr *shdrs;        // section header table
+    uint64_t shnum;                 // number of section headers
+    const char *shstrtab;           // section name string table
+    uint64_t symtab_idx;            // section index of the symbol table (0 if none)
+    const Elf64_Sym *symtab;        // symbol table
+    uint64_t nsyms;                 // number of symbols
+    const char *strtab;             // symbol name string table
+};
+
+
 /*
  * Helper function to get a section header with the given index.
  */
 static inline 
-const Elf64_Shdr * elf_section(const Elf64_Ehdr *eh, uint64_t idx)
+const Elf64_Shdr * elf_section(const struct elf_file *ef, uint64_t idx)
 {
-    return ((const Elf64_Shdr*) (((const uint8_t*) eh) + eh->e_shoff)) + idx;
+    return &ef->shdrs[idx];
+}
+
+
+/*
+ * Helper function to get the content of a section.
+ */
+static inline
+const void * elf_section_data(const struct elf_file *ef, const Elf64_Shdr *sh)
+{
+    return ef->data + sh->sh_offset;
 }
 
 
@@ -74,10 +106,9 @@ const Elf64_Shdr * elf_section(const Elf64_Ehdr *eh, uint64_t idx)
  * Helper function to get the symbol at the given index.
  */
 static inline 
-const Elf64_Sym * elf_symbol(const Elf64_Ehdr *eh, const Elf64_Shdr *sh, uint64_t idx)
+const Elf64_Sym * elf_symbol(const struct elf_file *ef, uint64_t idx)
 {
-    const Elf64_Sym *symtab = (const Elf64_Sym*) (((const uint8_t*) eh) + sh->sh_offset);
-    return &symtab[idx];
+    return &ef->symtab[idx];
 }
 
 
@@ -85,38 +116,171 @@ const Elf64_Sym * elf_symbol(const Elf64_Ehdr *eh, const Elf64_Shdr *sh, uint64_
  * Helper function to get the name of the symbol at the given index.
  */
 static inline
-const char * elf_symbol_name(const Elf64_Ehdr *eh, const Elf64_Shdr *sh, uint64_t idx)
+const char * elf_symbol_name(const struct elf_file *ef, uint64_t idx)
 {
-    const Elf64_Shdr *link = elf_section(eh, sh->sh_link);
-    const Elf64_Sym *symtab = (const Elf64_Sym*) (((const uint8_t*) eh) + sh->sh_offset);
-    const char *strtab = (const char*) ((const uint8_t*) eh) + link->sh_offset;
-    return &strtab[symtab[idx].st_name];
+    return ef->strtab + ef->symtab[idx].st_name;
 }
 
 
 /*
  * Helper function to look up a section name.
  */
-static const char * elf_section_name(const Elf64_Ehdr *ehdr, const Elf64_Shdr *shdr)
+static inline
+const char * elf_section_name(const struct elf_file *ef, const Elf64_Shdr *sh)
 {
-    if (ehdr->e_shstrndx == SHN_UNDEF) {
-        return NULL;
+    return ef->shstrtab + sh->sh_name;
+}
+
+
+/*
+ * Check that a string table is within the file and is terminated,
+ * so that any offset into it is a valid string.
+ */
+static bool check_strtab(const uint8_t *file_data, const Elf64_Shdr *sh)
+{
+    return sh->sh_type == SHT_STRTAB && sh->sh_size > 0 
+        && file_data[sh->sh_offset + sh->sh_size - 1] == '\0';
+}
+
+
+/*
+ * Validate section headers and the symbol table, and set up the 
+ * file context.
+ *
+ * Section header ranges, links and name offsets are checked in a 
+ * single pass that accumulates errors instead of branching, so the 
+ * compiler can vectorise it. The same is done for symbols.
+ */
+static int elf_file_open(struct elf_file *ef, const uint8_t *file_data, size_t file_size)
+{
+    static const char empty[] = "";
+    const Elf64_Ehdr *eh = (const void*) file_data;
+
+    memset(ef, 0, sizeof(struct elf_file));
+    ef->data = file_data;
+    ef->size = file_size;
+    ef->eh = eh;
+
+    if (eh->e_shoff == 0 || eh->e_shoff >= file_size 
+            || (file_size - eh->e_shoff) / sizeof(Elf64_Shdr) == 0) {
+        log_error("Section headers are outside file");
+        return EINVAL;
     }
 
+    const Elf64_Shdr *shdrs = (const Elf64_Shdr*) (file_data + eh->e_shoff);
+    uint64_t shnum = eh->e_shnum != 0 ? eh->e_shnum : shdrs[0].sh_size;
+
+    if ((file_size - eh->e_shoff) / sizeof(Elf64_Shdr) < shnum) {
+        log_error("Section headers are outside file");
+        return EINVAL;
+    }
+
+    ef->shdrs = shdrs;
+    ef->shnum = shnum;
+
     // Check if we're using an extended string table
-    uint32_t shstrndx = ehdr->e_shstrndx;
-    if (shstrndx == SHN_XINDEX) {
-        const Elf64_Shdr *nullsh = elf_section(ehdr, 0);
-        shstrndx = nullsh->sh_link;
+    uint64_t shstrndx = eh->e_shstrndx == SHN_XINDEX ? shdrs[0].sh_link : eh->e_shstrndx;
+    uint64_t shstrsz = 1;
+    ef->shstrtab = empty;
+
+    if (shstrndx != SHN_UNDEF) {
+        const Elf64_Shdr *sh = &shdrs[shstrndx];
+
+        if (shstrndx >= shnum || sh->sh_offset > file_size 
+                || file_size - sh->sh_offset < sh->sh_size || !check_strtab(file_data, sh)) {
+            log_error("Invalid section name string table");
+            return EINVAL;
+        }
+
+        ef->shstrtab = (const char*) (file_data + sh->sh_offset);
+        shstrsz = sh->sh_size;
     }
 
-    const Elf64_Shdr *sh = elf_section(ehdr, shstrndx);
-    if (sh->sh_type != SHT_STRTAB) {
-        log_warning("ELF section %u has incorrect type", ehdr->e_shstrndx);
+    uint64_t invalid = 0;
+    for (uint64_t i = 0; i < shnum; ++i) {
+        const Elf64_Shdr *sh = &shdrs[i];
+        uint64_t has_data = (sh->sh_type != SHT_NOBITS) & (sh->sh_type != SHT_NULL);
+
+        invalid |= has_data & ((sh->sh_offset > file_size) | (file_size - sh->sh_offset < sh->sh_size));
+        invalid |= (sh->sh_link >= shnum) & (i != 0);
+        invalid |= sh->sh_name >= shstrsz;
     }
 
-    const char *strtab = ((const char*) ehdr) + elf_section(ehdr, ehdr->e_shstrndx)->sh_offset;
-    return strtab + shdr->sh_name;
+    if (invalid) {
+        log_error("Section headers refer to data outside file");
+        return EINVAL;
+    }
+
+    // Locate the symbol table, and check tables that refer to it
+    for (uint64_t i = 0; i < shnum; ++i) {
+        const Elf64_Shdr *sh = &shdrs[i];
+
+        switch (sh->sh_type) {
+            case SHT_SYMTAB:
+                if (ef->symtab_idx != 0) {
+                    log_warning("Multiple symbol tables detected in file");
+                    break;
+                }
+
+                if (sh->sh_entsize != sizeof(Elf64_Sym) || !check_strtab(file_data, &shdrs[sh->sh_link])) {
+                    log_error("Invalid symbol table");
+                    return EINVAL;
+                }
+
+                ef->symtab_idx = i;
+                ef->symtab = (const Elf64_Sym*) (file_data + sh->sh_offset);
+                ef->nsyms = sh->sh_size / sizeof(Elf64_Sym);
+                ef->strtab = (const char*) (file_data + shdrs[sh->sh_link].sh_offset);
+                break;
+
+            case SHT_RELA:
+                if (sh->sh_entsize != sizeof(Elf64_Rela) || sh->sh_info >= shnum) {
+                    log_error("Invalid relocation table %s", ef->shstrtab + sh->sh_name);
+                    return EINVAL;
+                }
+                break;
+
+            case SHT_GROUP:
+                if (sh->sh_size < sizeof(uint32_t)) {
+                    log_error("Invalid section group %s", ef->shstrtab + sh->sh_name);
+                    return EINVAL;
+                }
+                break;
+        }
+    }
+
+    const Elf64_Shdr *symtab = &shdrs[ef->symtab_idx];
+    uint64_t strsz = ef->symtab_idx != 0 ? shdrs[symtab->sh_link].sh_size : 0;
+    
+    invalid = 0;
+    for (uint64_t i = 0; i < ef->nsyms; ++i) {
+        const Elf64_Sym *sym = &ef->symtab[i];
+
+        invalid |= sym->st_name >= strsz;
+        invalid |= (sym->st_shndx >= shnum) & (sym->st_shndx < SHN_LORESERVE);
+    }
+
+    if (invalid) {
+        log_error("Symbol table refers to data outside file");
+        return EINVAL;
+    }
+
+    // Section groups and relocation tables must refer to the symbol table
+    for (uint64_t i = 0; i < shnum; ++i) {
+        const Elf64_Shdr *sh = &shdrs[i];
+
+        if (sh->sh_type == SHT_GROUP && (sh->sh_link != ef->symtab_idx || sh->sh_info >= ef->nsyms)) {
+            log_error("Section group %s refers to unknown symbol", ef->shstrtab + sh->sh_name);
+            return EINVAL;
+        }
+
+        if (sh->sh_type == SHT_RELA && sh->sh_link != ef->symtab_idx) {
+            log_error("Relocation table %s refers to unknown symbol table", ef->shstrtab + sh->sh_name);
+            return EINVAL;
+        }
+    }
+
+    return 0;
 }
 
 
@@ -136,82 +300,206 @@ static inline int add_section(struct list_head *list, const Elf64_Shdr *sh)
 
 
 /*
- * Parse ELF file and create sections
+ * Rule for sections with special names.
  */
-static int parse_sections(const Elf64_Ehdr *eh, 
-                          const struct linkerctx *ctx,
-                          struct section_table *sections,
-                          struct list_head *groups,
-                          struct list_head *reltabs,
-                          struct list_head *symtabs)
+struct section_rule
 {
-    uint64_t shnum = eh->e_shnum;
+    const char *name;           // section name (or prefix)
+    size_t length;              // length of the name
+    bool prefix;                // match all names starting with name
+    bool discard;               // discard the section
+    uint32_t sh_type;           // only retype sections of this type (SHT_NULL for any type)
+    enum section_type type;     // section type to use (SECTION_MAX_TYPES to keep the type)
+};
+
+
+#define SECTION_DISCARD(_name, _prefix) \
+    { .name = (_name), .length = sizeof(_name) - 1, .prefix = (_prefix), \
+      .discard = true, .sh_type = SHT_NULL, .type = SECTION_MAX_TYPES }
+
+#define SECTION_RETYPE(_name, _prefix, _sh_type, _type) \
+    { .name = (_name), .length = sizeof(_name) - 1, .prefix = (_prefix), \
+      .discard = false, .sh_type = (_sh_type), .type = (_type) }
 
-    if (shnum == 0) {
-        const Elf64_Shdr *nullsect = elf_section(eh, 0);
-        shnum = nullsect->sh_size;
+
+/*
+ * Section name rules, sorted by the second character of the name.
+ */
+static const struct section_rule section_rules[] = {
+    SECTION_DISCARD(".annobin.", true),
+    SECTION_DISCARD(".comment", false),
+    SECTION_RETYPE(".debug_", true, SHT_NULL, SECTION_DEBUG),
+    // FIXME: Implement CIE/DWARF parser in the future
+    SECTION_RETYPE(".eh_frame", false, SHT_PROGBITS, SECTION_UNWIND),
+    SECTION_DISCARD(".llvm_addrsig", false),
+    SECTION_DISCARD(".note.GNU-stack", false),
+};
+
+
+/*
+ * Range of rules for every second character of a section name.
+ * Built once when the front-end is registered.
+ */
+static struct {
+    uint8_t first;
+    uint8_t count;
+} section_rule_index[256];
+
+
+static void build_section_rule_index(void)
+{
+    for (size_t i = 0; i < sizeof(section_rules) / sizeof(section_rules[0]); ++i) {
+        uint8_t c = (uint8_t) section_rules[i].name[1];
+
+        assert(i == 0 || (uint8_t) section_rules[i - 1].name[1] <= c);
+        if (section_rule_index[c].count++ == 0) {
+            section_rule_index[c].first = i;
+        }
     }
+}
 
-    section_table_reserve(sections, shnum);
 
-    log_trace("Scanning sections");
+/*
+ * Look up the rule for a section name, if any.
+ * Most section names are only compared against one or two rules.
+ */
+static const struct section_rule * lookup_section_rule(const char *name)
+{
+    if (name == NULL || name[0] != '.') {
+        return NULL;
+    }
+
+    uint8_t c = (uint8_t) name[1];
+    const struct section_rule *rule = &section_rules[section_rule_index[c].first];
+
+    for (uint8_t i = 0; i < section_rule_index[c].count; ++i, ++rule) {
+        if (strncmp(name, rule->name, rule->length) == 0 
+                && (rule->prefix || name[rule->length] == '\0')) {
+            return rule;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Reasons for not loading a section, recorded in the discarded array.
+ */
+#define DISCARDED_GROUP     1   // section belongs to a group loaded from another file
+#define DISCARDED_STRIPPED  2   // section is stripped, see linker_is_section_stripped()
+
+
+/*
+ * Find COMDAT section groups that are already loaded from another
+ * file, and mark the group sections and their members as discarded.
+ *
+ * Discarded sections are never created, so their relocations are 
+ * never parsed either. The discarded array is only allocated if 
+ * there are sections to discard, and records why every section 
+ * was discarded.
+ */
+static int discard_loaded_groups(const struct elf_file *ef,
+                                 const struct linkerctx *ctx,
+                                 uint8_t **discarded)
+{
+    uint64_t shnum = ef->shnum;
+    *discarded = NULL;
 
     for (uint64_t shndx = 0; shndx < shnum; ++shndx) {
-        const Elf64_Shdr *sh = elf_section(eh, shndx);
-        const char *shname = elf_section_name(eh, sh);
+        const Elf64_Shdr *sh = elf_section(ef, shndx);
+
+        if (sh->sh_type != SHT_GROUP) {
+            continue;
+        }
+
+        const char *signature = elf_symbol_name(ef, sh->sh_info);
+        const uint32_t *entries = elf_section_data(ef, sh);
+
+        if (!(entries[0] & GRP_COMDAT) || !linker_is_group_loaded(ctx, signature)) {
+            continue;
+        }
+
+        if (*discarded == NULL) {
+            *discarded = calloc(shnum, sizeof(uint8_t));
+            if (*discarded == NULL) {
+                return ENOMEM;
+            }
+        }
+
+        log_trace("Skipping section group %s, already loaded from another file", signature);
+
+        (*discarded)[shndx] = DISCARDED_GROUP;
+        for (uint32_t idx = 1; idx < sh->sh_size / sizeof(uint32_t); ++idx) {
+            if (entries[idx] < shnum) {
+                (*discarded)[entries[idx]] = DISCARDED_GROUP;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * Parse ELF file and create sections
+ */
+static int parse_sections(const struct elf_file *ef, 
+                          const struct linkerctx *ctx,
+                          uint8_t **discarded,
+                          struct section_table *sections,
+                          struct list_head *groups)
+{
+    section_table_reserve(sections, ef->shnum);
+
+    log_trace("Scanning sections");
+
+    for (uint64_t shndx = 0; shndx < ef->shnum; ++shndx) {
+        const Elf64_Shdr *sh = elf_section(ef, shndx);
+        const char *shname = elf_section_name(ef, sh);
+        const struct section_rule *rule = lookup_section_rule(shname);
+
+        if (*discarded != NULL && (*discarded)[shndx]) {
+            continue;
+        }
 
-        log_ctx_push(LOG_CTX_SECTION(shname));
+        if (rule != NULL && rule->discard) {
+            log_trace("Discarding section %s (index %u)", shname, shndx);
+            continue;
+        }
 
         enum section_type type = SECTION_MAX_TYPES;
 
         switch (sh->sh_type) {
             case SHT_GROUP:
                 if (add_section(groups, sh) != 0) {
-                    log_ctx_pop();
                     return ENOMEM;
                 }
                 break;
 
             case SHT_SYMTAB:
-                log_trace("Identified symbol table section");
-
-                if (!list_empty(symtabs)) {
-                    log_warning("Multiple symbol tables detected in file");
-                }
-                
-                if (add_section(symtabs, sh) != 0) {
-                    log_ctx_pop();
-                    return ENOMEM;
-                }
+                log_trace("Identified symbol table section %s", shname);
                 break;
 
             case SHT_STRTAB:
-                if (eh->e_shstrndx != shndx) {
-                    log_trace("Identified string table section");
+                if ((const char*) elf_section_data(ef, sh) != ef->shstrtab) {
+                    log_trace("Identified string table section %s", shname);
                 }
                 break;
 
             case SHT_REL:
                 if (sh->sh_type == SHT_REL) {
-                    log_warning("Relocation type REL is unsupported and will be ignored");
+                    log_warning("Relocation type REL is unsupported and section %s will be ignored", shname);
                 }
                 break;
 
             case SHT_RELA:
-                log_trace("Identified relocation table section");
-
-                if (add_section(reltabs, sh) != 0) {
-                    log_ctx_pop();
-                    return ENOMEM;
-                }
+                // Relocation tables are parsed in the second phase
+                log_trace("Identified relocation table section %s", shname);
                 break;
 
             case SHT_PROGBITS:
-                if (strcmp(shname, ".eh_frame") == 0) {
-                    // FIXME: Implement CIE/DWARF parser in the future
-                    log_trace("Section is .eh_frame");
-                    type = SECTION_UNWIND;
-                } else if (!!(sh->sh_flags & SHF_ALLOC)) {
+                if (!!(sh->sh_flags & SHF_ALLOC)) {
                     if (!!(sh->sh_flags & SHF_WRITE)) {
                         type = SECTION_DATA;
                     } else if (!!(sh->sh_flags & SHF_EXECINSTR)) {
@@ -258,25 +546,38 @@ static int parse_sections(const Elf64_Ehdr *eh,
                 break;
         }
 
-        // Discard .commend and .annobin.notes
-        if (strcmp(shname, ".comment") == 0 || strncmp(shname, ".annobin.", 9) == 0) {
-            log_trace("Discarding section %s (index %u)", shname, shndx);
-            log_ctx_pop();
+        // Only extract sections that are relevant for the linker
+        if (type >= SECTION_MAX_TYPES) {
             continue;
         }
 
-        // Only extract sections that are relevant for the linker
-        if (type >= SECTION_MAX_TYPES) {
-            log_ctx_pop();
+        if (rule != NULL && rule->type < SECTION_MAX_TYPES 
+                && (rule->sh_type == SHT_NULL || rule->sh_type == sh->sh_type)
+                && (rule->type != SECTION_DEBUG || !(sh->sh_flags & SHF_ALLOC))) {
+            log_trace("Section %s (index %u) is %s", shname, shndx, section_type_to_string(rule->type));
+            type = rule->type;
+        }
+
+        if (linker_is_section_stripped(ctx, type, !!(sh->sh_flags & SHF_ALLOC))) {
+            log_trace("Stripping section %s (index %u)", shname, shndx);
+
+            // Remember the section, so symbols defined in it can be dropped
+            if (*discarded == NULL) {
+                *discarded = calloc(ef->shnum, sizeof(uint8_t));
+                if (*discarded == NULL) {
+                    return ENOMEM;
+                }
+            }
+            (*discarded)[shndx] = DISCARDED_STRIPPED;
             continue;
         }
 
         if (!!(sh->sh_flags & SHF_MERGE)) {
             if (sh->sh_flags & SHF_STRINGS) {
-                log_trace("Section is a string merge section");
+                log_trace("Section %s is a string merge section", shname);
             } else {
-                log_trace("Merge section contains %lu entries of size %u",
-                        sh->sh_size / sh->sh_entsize, sh->sh_entsize);
+                log_trace("Merge section %s contains %lu entries of size %u",
+                        shname, sh->sh_size / sh->sh_entsize, sh->sh_entsize);
             }
 
             //log_info("Merge sections are not supported yet");
@@ -284,38 +585,320 @@ static int parse_sections(const Elf64_Ehdr *eh,
 
         struct section *section = section_alloc(ctx, shname, type, sh->sh_size);
         if (section == NULL) {
-            log_ctx_pop();
             return ENOMEM;
         }
 
         if (sh->sh_type != SHT_NOBITS) {
-            section->content = ((const uint8_t*) eh) + sh->sh_offset;
+            section->content = elf_section_data(ef, sh);
         }
 
         bool added = section_table_insert(sections, shndx, section, NULL);
         section_put(section);
         if (!added) {
             log_fatal("Could not add section %llu to section table", shndx);
-            log_ctx_pop();
             return ENOMEM;
         }
+    }
 
-        log_ctx_pop();
+    return 0;
+}
+
+
+/*
+ * Create a symbol descriptor for the symbol at the given index.
+ * The name is interned in the locals string pool if it is set,
+ * or in the linker's global string pool otherwise.
+ *
+ * If the symbol is of a kind the linker ignores, zero is returned 
+ * and symbol is set to NULL. Symbols defined in sections of a 
+ * discarded section group are created as undefined references, 
+ * so that they resolve to the definition that is kept. Symbols 
+ * defined in stripped sections are ignored.
+ */
+static int create_symbol(const struct elf_file *ef,
+                         uint64_t idx,
+                         const struct linkerctx *ctx,
+                         struct strpool *locals,
+                         const struct section_table *sections,
+                         const uint8_t *discarded,
+                         struct symbol **symbol)
+{
+    const Elf64_Sym *sym = elf_symbol(ef, idx);
+    const char *name = elf_symbol_name(ef, idx);
+    struct section *section = NULL; 
+    uint64_t align = 0;
+    uint64_t offset = 0;
+    uint64_t size = sym->st_size;
+
+    enum symbol_type type = SYMBOL_MAX_TYPES;
+    enum symbol_binding binding = SYMBOL_LOCAL;
+    enum symbol_export visibility = SYMBOL_PUBLIC;
+
+    *symbol = NULL;
+
+    switch (ELF64_ST_VISIBILITY(sym->st_other)) {
+        case STV_HIDDEN:
+            visibility = SYMBOL_PRIVATE;
+            break;
+
+        case STV_INTERNAL:
+            visibility = SYMBOL_INTERNAL;
+            break;
+
+        case STV_PROTECTED:
+            visibility = SYMBOL_PROTECTED;
+            break;
+
+        case STV_DEFAULT:
+        default:
+            visibility = SYMBOL_PUBLIC;
+            break;
+    }
+
+    switch (sym->st_shndx) {
+        case SHN_UNDEF:
+            break;
+
+        case SHN_ABS:
+            offset = sym->st_value;
+            break;
+
+        case SHN_COMMON:
+            align = sym->st_value;
+            break;
+        
+        default:
+            section = section_table_at(sections, sym->st_shndx);
+            if (section == NULL && ELF64_ST_BIND(sym->st_info) == STB_LOCAL) {
+                // Local symbol in a section that was discarded, leave it undefined
+                if (ELF64_ST_TYPE(sym->st_info) == STT_SECTION) {
+                    name = elf_section_name(ef, elf_section(ef, sym->st_shndx));
+                }
+                log_trace("Local symbol '%s' (index %u) refers to discarded section %u",
+                        name, idx, sym->st_shndx);
+                break;
+            } else if (section == NULL && discarded != NULL && discarded[sym->st_shndx] == DISCARDED_STRIPPED) {
+                log_trace("Ignoring symbol '%s' (index %u) defined in stripped section", name, idx);
+                return 0;
+            } else if (section == NULL && discarded != NULL && discarded[sym->st_shndx] == DISCARDED_GROUP) {
+                log_trace("Symbol '%s' (index %u) is defined in discarded section group", name, idx);
+                break;
+            } else if (section == NULL) {
+                log_debug("Symbol '%s' (index %u, type %u, binding %u) refers to unmapped section %u",
+                        name, idx, 
+                        ELF64_ST_TYPE(sym->st_info), 
+                        ELF64_ST_BIND(sym->st_info), 
+                        sym->st_shndx);
+                return EINVAL;
+            }
+            offset = sym->st_value;
+            break;
+    }
+
+    switch (ELF64_ST_BIND(sym->st_info)) {
+        case STB_GLOBAL:
+        case STB_GNU_UNIQUE:
+            // Unique symbols are globals that are deduplicated with their section group
+            binding = SYMBOL_GLOBAL;
+            break;
+
+        case STB_WEAK:
+            binding = SYMBOL_WEAK;
+            break;
+
+        case STB_LOCAL:
+        default:
+            binding = SYMBOL_LOCAL;
+            break;
+    }
+
+    switch (ELF64_ST_TYPE(sym->st_info)) {
+        case STT_NOTYPE:
+            type = SYMBOL_NOTYPE;
+            break;
+
+        case STT_OBJECT:
+            type = SYMBOL_OBJECT;
+            break;
+
+        case STT_TLS:
+            type = SYMBOL_TLS;
+            break;
+
+        case STT_SECTION:
+            // Section symbols are named after the section
+            if (section != NULL) {
+                name = section_name(section);
+            }
+            type = SYMBOL_SECTION;
+            break;
+
+        case STT_GNU_IFUNC:
+        case STT_FUNC:
+            type = SYMBOL_FUNCTION;
+            break;
+
+        case STT_COMMON:
+            // treat as weak, uninitialized data
+            type = SYMBOL_NOTYPE;
+            binding = SYMBOL_WEAK;
+            align = sym->st_value;
+            break;
+
+        case STT_LOPROC:
+        case STT_HIPROC:
+            log_warning("Unsupported processor specific symbol type %u", 
+                    ELF64_ST_TYPE(sym->st_info));
+            return 0;
+
+        case STT_FILE:
+            return 0;
+
+        default:
+            log_warning("Detected symbol '%s' with unknown type %u", 
+                    name, ELF64_ST_TYPE(sym->st_info));
+            type = STT_NOTYPE;
+            break;
     }
 
+    if (type >= SYMBOL_MAX_TYPES) {
+        log_warning("Ignoring symbol '%s' with unknown type", name);
+        return 0;
+    }
+
+    struct symbol *s = locals != NULL ? symbol_alloc_strings(locals, name, type, binding)
+                                      : symbol_alloc(ctx, name, type, binding);
+    if (s == NULL) {
+        return ENOMEM;
+    }
+    s->visibility = visibility;
+
+    bool defined = false;
+    if (align > 0) {
+        defined = symbol_define_common(s, size, align);
+    } else if (offset > 0 || section != NULL) {
+        defined = symbol_define(s, section, offset, size);
+    } 
+    if ((align > 0 || section != NULL || offset > 0) && !defined) {
+        symbol_put(s);
+        return EEXIST;
+    }
+
+    *symbol = s;
     return 0;
 }
 
 
+/*
+ * Parse the symbol table and create global and weak symbols.
+ *
+ * Local symbols are only created if a relocation refers to them,
+ * see local_symbol(), as most of them are never used by the linker.
+ */
+static int parse_symtab(const struct elf_file *ef, 
+                        const struct linkerctx *ctx,
+                        const struct section_table *sections, 
+                        const uint8_t *discarded,
+                        struct symbol_table *symbols)
+{
+    int status = -1;
+
+    log_ctx_push(LOG_CTX_SECTION(elf_section_name(ef, elf_section(ef, ef->symtab_idx))));
+
+    if (!symbol_table_reserve(symbols, ef->nsyms)) {
+        log_ctx_pop();
+        return ENOMEM;
+    }
+
+    log_trace("Parsing symbol table");
+    for (uint32_t idx = 1; idx < ef->nsyms; ++idx) {
+        const Elf64_Sym *sym = elf_symbol(ef, idx);
+
+        if (ELF64_ST_BIND(sym->st_info) == STB_LOCAL) {
+            continue;
+        }
+
+        struct symbol *symbol = NULL;
+        status = create_symbol(ef, idx, ctx, NULL, sections, discarded, &symbol);
+        if (status != 0) {
+            goto out;
+        }
+
+        if (symbol == NULL) {
+            continue;
+        }
+
+        bool added = symbol_table_insert(symbols, idx, symbol, NULL);
+        symbol_put(symbol);
+        if (!added) {
+            log_fatal("Could not add symbol %llu to symbol table", idx);
+            status = ENOMEM;
+            goto out;
+        }
+    }
+
+    log_trace("Parsed symbol table");
+    status = 0;
+
+out:
+    log_ctx_pop();
+    return status;
+}
+
+
+/*
+ * Create a local symbol that a relocation refers to, and add it
+ * to the symbol table so that later relocations can reuse it.
+ *
+ * Local symbol names are interned in a string pool for the file,
+ * which is created the first time it is needed.
+ */
+static struct symbol * local_symbol(const struct elf_file *ef, 
+                                    uint64_t idx,
+                                    struct strpool **locals,
+                                    const struct section_table *sections,
+                                    struct symbol_table *symbols)
+{
+    if (idx == 0 || idx >= ef->nsyms) {
+        return NULL;
+    }
+
+    if (ELF64_ST_BIND(elf_symbol(ef, idx)->st_info) != STB_LOCAL) {
+        return NULL;
+    }
+
+    if (*locals == NULL) {
+        *locals = strpool_alloc();
+        if (*locals == NULL) {
+            return NULL;
+        }
+    }
+
+    struct symbol *symbol = NULL;
+    if (create_symbol(ef, idx, NULL, *locals, sections, NULL, &symbol) != 0 || symbol == NULL) {
+        return NULL;
+    }
+
+    bool added = symbol_table_insert(symbols, idx, symbol, NULL);
+    symbol_put(symbol);
+    if (!added) {
+        return NULL;
+    }
+
+    return symbol;
+}
+
+
 /*
  * Parse a relocation table.
  */
-static int parse_reltab(const Elf64_Ehdr *eh, 
+static int parse_reltab(const struct elf_file *ef, 
                         const Elf64_Shdr *sh, 
                         const struct section_table *sects, 
-                        const struct symbol_table *syms)
+                        struct symbol_table *syms,
+                        struct strpool **locals)
 {
-    log_ctx_push(LOG_CTX_SECTION(elf_section_name(eh, sh)));
+    log_ctx_push(LOG_CTX_SECTION(elf_section_name(ef, sh)));
 
     switch (sh->sh_type) {
         case SHT_REL:
@@ -352,25 +935,31 @@ static int parse_reltab(const Elf64_Ehdr *eh,
     for (uint64_t idx = 0; idx < sh->sh_size / sh->sh_entsize; ++idx) {
 
         struct symbol *sym = NULL;
+        uint64_t symidx = 0;
         uint64_t offset = 0;
         uint32_t type = 0;
         int64_t addend = 0;
 
         if (sh->sh_type == SHT_RELA) {
-            const Elf64_Rela *relatab = (const Elf64_Rela*) (((const uint8_t*) eh) + sh->sh_offset);
+            const Elf64_Rela *relatab = elf_section_data(ef, sh);
             const Elf64_Rela *r = &relatab[idx];
         
             type = ELF64_R_TYPE(r->r_info);
             offset = r->r_offset;
             addend = r->r_addend;
-            sym = symbol_table_at(syms, ELF64_R_SYM(r->r_info));
+            symidx = ELF64_R_SYM(r->r_info);
         } else {
-            const Elf64_Rel *reltab = (const Elf64_Rel*) (((const uint8_t*) eh) + sh->sh_offset);
+            const Elf64_Rel *reltab = elf_section_data(ef, sh);
             const Elf64_Rel *r = &reltab[idx];
 
             type = ELF64_R_TYPE(r->r_info);
             offset = r->r_offset;
-            sym = symbol_table_at(syms, ELF64_R_SYM(r->r_info));
+            symidx = ELF64_R_SYM(r->r_info);
+        }
+
+        sym = symbol_table_at(syms, symidx);
+        if (sym == NULL) {
+            sym = local_symbol(ef, symidx, locals, sects, syms);
         }
 
         if (sym == NULL) {
@@ -381,7 +970,7 @@ static int parse_reltab(const Elf64_Ehdr *eh,
 
         //log_trace("Relocation %lu at offset %zu is relative to symbol '%s'", idx, offset, sym->name);
 
-        struct reloc * reloc = section_add_reloc(sect, offset, sym, type, addend);
+        struct reloc * reloc = section_add_reloc(sect, offset, sym, symidx, type, addend);
         if (reloc == NULL) {
             log_ctx_pop();
             return ENOMEM;
@@ -393,15 +982,15 @@ static int parse_reltab(const Elf64_Ehdr *eh,
 }
 
 
-static int parse_group(const Elf64_Ehdr *eh,
+static int parse_group(const struct elf_file *ef,
                        const Elf64_Shdr *sh,
                        const struct section_table *sections,
                        struct groups *groups)
 {
-    log_ctx_push(LOG_CTX_SECTION(elf_section_name(eh, sh)));
+    log_ctx_push(LOG_CTX_SECTION(elf_section_name(ef, sh)));
 
-    const char *signature = elf_symbol_name(eh, elf_section(eh, sh->sh_link), sh->sh_info);
-    const uint32_t *entries = (const uint32_t*) (((const uint8_t*) eh) + sh->sh_offset);
+    const char *signature = elf_symbol_name(ef, sh->sh_info);
+    const uint32_t *entries = elf_section_data(ef, sh);
     bool comdat = true;
 
     // First entry contains GRP_COMDAT in almost all cases
@@ -426,217 +1015,46 @@ static int parse_group(const Elf64_Ehdr *eh,
 }
 
 
-/*
- * Parse the symbol table and extract symbols.
- */
-static int parse_symtab(const Elf64_Ehdr *eh, 
-                        const Elf64_Shdr *sh, 
-                        const struct linkerctx *ctx,
-                        const struct section_table *sections, 
-                        struct symbol_table *symbols)
-{
-    int status = -1;
-    assert(sh->sh_type == SHT_SYMTAB);
-
-    log_ctx_push(LOG_CTX_SECTION(elf_section_name(eh, sh)));
-
-    if (!symbol_table_reserve(symbols, sh->sh_size / sh->sh_entsize)) {
-        log_ctx_pop();
-        return ENOMEM;
-    }
-
-    log_trace("Parsing symbol table");
-    for (uint32_t idx = 1; idx < sh->sh_size / sh->sh_entsize; ++idx) {
-        const Elf64_Sym *sym = elf_symbol(eh, sh, idx);
-        const char *name = elf_symbol_name(eh, sh, idx);
-        struct section *section = NULL; 
-        uint64_t align = 0;
-        uint64_t offset = 0;
-        uint64_t size = sym->st_size;
-
-        enum symbol_type type = SYMBOL_MAX_TYPES;
-        enum symbol_binding binding = SYMBOL_LOCAL;
-        enum symbol_export visibility = SYMBOL_PUBLIC;
-
-        switch (ELF64_ST_VISIBILITY(sym->st_other)) {
-            case STV_HIDDEN:
-                visibility = SYMBOL_PRIVATE;
-                break;
-
-            case STV_INTERNAL:
-                visibility = SYMBOL_INTERNAL;
-                break;
-
-            case STV_PROTECTED:
-                visibility = SYMBOL_PROTECTED;
-                break;
-
-            case STV_DEFAULT:
-            default:
-                visibility = SYMBOL_PUBLIC;
-                break;
-        }
-
-        switch (sym->st_shndx) {
-            case SHN_UNDEF:
-                break;
-
-            case SHN_ABS:
-                offset = sym->st_value;
-                break;
-
-            case SHN_COMMON:
-                align = sym->st_value;
-                break;
-            
-            default:
-                section = section_table_at(sections, sym->st_shndx);
-                if (section == NULL) {
-                    log_debug("Symbol '%s' (index %u, type %u, binding %u) refers to unmapped section %u",
-                            name, idx, 
-                            ELF64_ST_TYPE(sym->st_info), 
-                            ELF64_ST_BIND(sym->st_info), 
-                            sym->st_shndx);
-                    status = EINVAL;
-                    goto out;
-                }
-                offset = sym->st_value;
-                break;
-        }
-
-        switch (ELF64_ST_BIND(sym->st_info)) {
-            case STB_GLOBAL:
-                binding = SYMBOL_GLOBAL;
-                break;
-
-            case STB_WEAK:
-                binding = SYMBOL_WEAK;
-                break;
-
-            case STB_LOCAL:
-            default:
-                binding = SYMBOL_LOCAL;
-                break;
-        }
-
-        switch (ELF64_ST_TYPE(sym->st_info)) {
-            case STT_NOTYPE:
-                type = SYMBOL_NOTYPE;
-                break;
-
-            case STT_OBJECT:
-                type = SYMBOL_OBJECT;
-                break;
-
-            case STT_TLS:
-                type = SYMBOL_TLS;
-                break;
-
-            case STT_SECTION:
-                name = section_name(section);
-                type = SYMBOL_SECTION;
-                break;
-
-            case STT_GNU_IFUNC:
-            case STT_FUNC:
-                type = SYMBOL_FUNCTION;
-                break;
-
-            case STT_COMMON:
-                // treat as weak, uninitialized data
-                type = SYMBOL_NOTYPE;
-                binding = SYMBOL_WEAK;
-                align = sym->st_value;
-                break;
-
-            case STT_LOPROC:
-            case STT_HIPROC:
-                log_warning("Unsupported processor specific symbol type %u", 
-                        ELF64_ST_TYPE(sym->st_info));
-                continue;
-
-            case STT_FILE:
-                type = SYMBOL_DEBUG;
-                continue;
-
-            default:
-                log_warning("Detected symbol '%s' with unknown type %u", 
-                        name, ELF64_ST_TYPE(sym->st_info));
-                type = STT_NOTYPE;
-                break;
-        }
-
-        if (type >= SYMBOL_MAX_TYPES) {
-            log_warning("Ignoring symbol '%s' with unknown type", name);
-            continue;
-        }
-
-        struct symbol *symbol = symbol_alloc(ctx, name, type, binding);
-        if (symbol == NULL) {
-            status = ENOMEM;
-            goto out;
-        }
-        symbol->visibility = visibility;
-
-        bool defined = false;
-        if (align > 0) {
-            defined = symbol_define_common(symbol, size, align);
-        } else if (offset > 0 || section != NULL) {
-            defined = symbol_define(symbol, section, offset, size);
-        } 
-        if ((align > 0 || section != NULL || offset > 0) && !defined) {
-            symbol_put(symbol);
-            status = EEXIST;
-            goto out;
-        }
-
-        bool added = symbol_table_insert(symbols, idx, symbol, NULL);
-        symbol_put(symbol);
-        if (!added) {
-            log_fatal("Could not add symbol %llu to symbol table", idx);
-            status = ENOMEM;
-            goto out;
-        }
-    }
-
-    log_trace("Parsed symbol table");
-    status = 0;
-
-out:
-    log_ctx_pop();
-    return status;
-}
-
 static int parse_elf_file(const struct linkerctx *ctx,
                           const uint8_t *file_data, 
                           size_t file_size,
                           struct groups *groups,
                           struct section_table *sections, 
-                          struct symbol_table *symbols)
+                          struct symbol_table *symbols,
+                          void **state)
 {
     int status = 0;
-    const Elf64_Ehdr* eh = (const void*) file_data;
-    struct list_head reltabs = LIST_HEAD_INIT(reltabs);
-    struct list_head symtabs = LIST_HEAD_INIT(symtabs);
+    struct elf_file ef;
     struct list_head groupsects = LIST_HEAD_INIT(groupsects);
+    uint8_t *discarded = NULL;
 
-    (void) file_size; // unused parameter
-    
-    // Parse file and create sections
-    status = parse_sections(eh, ctx, sections, &groupsects, &reltabs, &symtabs);
+    *state = NULL;
+
+    status = elf_file_open(&ef, file_data, file_size);
     if (status != 0) {
-        goto cleanup;
+        return status;
     }
 
-    if (list_empty(&symtabs)) {
+    if (ef.symtab_idx == 0) {
         log_error("Could not locate symbol table");
-        status = EINVAL;
+        return EINVAL;
+    }
+
+    // Skip section groups that are already loaded before creating any sections
+    status = discard_loaded_groups(&ef, ctx, &discarded);
+    if (status != 0) {
+        goto cleanup;
+    }
+    
+    // Parse file and create sections
+    status = parse_sections(&ef, ctx, &discarded, sections, &groupsects);
+    if (status != 0) {
         goto cleanup;
     }
 
     // Parse section groups
     list_for_each_entry_safe(s, &groupsects, struct elf_section, entry) {
-        status = parse_group(eh, s->sh, sections, groups);
+        status = parse_group(&ef, s->sh, sections, groups);
         if (status != 0) {
             goto cleanup;
         }
@@ -645,24 +1063,19 @@ static int parse_elf_file(const struct linkerctx *ctx,
     }
 
     // Parse symbol table
-    list_for_each_entry_safe(s, &symtabs, struct elf_section, entry) {
-        status = parse_symtab(eh, s->sh, ctx, sections, symbols);
-        if (status != 0) {
-            goto cleanup;
-        }
-        list_remove(&s->entry);
-        free(s);
+    status = parse_symtab(&ef, ctx, sections, discarded, symbols);
+    if (status != 0) {
+        goto cleanup;
     }
 
-    // Parse relocation tables
-    list_for_each_entry_safe(s, &reltabs, struct elf_section, entry) {
-        status = parse_reltab(eh, s->sh, sections, symbols);
-        if (status != 0) {
-            goto cleanup;
-        }
-        list_remove(&s->entry);
-        free(s);
+    // Keep the validated file context for loading relocations
+    struct elf_file *copy = malloc(sizeof(struct elf_file));
+    if (copy == NULL) {
+        status = ENOMEM;
+        goto cleanup;
     }
+    *copy = ef;
+    *state = copy;
 
 cleanup:
     list_for_each_entry_safe(s, &groupsects, struct elf_section, entry) {
@@ -670,29 +1083,97 @@ cleanup:
         free(s);
     }
 
-    list_for_each_entry_safe(s, &symtabs, struct elf_section, entry) {
-        list_remove(&s->entry);
-        free(s);
+    free(discarded);
+    return status;
+}
+
+
+/*
+ * Parse relocation tables for the sections that were kept (second phase).
+ * The file was validated by parse_elf_file(), which left its context in state.
+ */
+static int parse_elf_relocs(void *state,
+                            struct section_table *sections,
+                            struct symbol_table *symbols)
+{
+    int status = 0;
+    const struct elf_file *ef = state;
+    struct strpool *locals = NULL;
+
+    for (uint64_t shndx = 0; shndx < ef->shnum && status == 0; ++shndx) {
+        const Elf64_Shdr *sh = elf_section(ef, shndx);
+
+        if (sh->sh_type != SHT_RELA) {
+            continue;
+        }
+
+        // Skip relocations for sections that were discarded
+        if (section_table_at(sections, sh->sh_info) == NULL) {
+            continue;
+        }
+
+        status = parse_reltab(ef, sh, sections, symbols, &locals);
     }
 
-    list_for_each_entry_safe(s, &reltabs, struct elf_section, entry) {
-        list_remove(&s->entry);
-        free(s);
+    // Local symbols hold their own references to the string pool
+    if (locals != NULL) {
+        strpool_put(locals);
     }
 
     return status;
 }
 
 
+/*
+ * Report defined global and weak symbols, without parsing the rest of the file.
+ */
+static int scan_elf_globals(const uint8_t *file_data,
+                            size_t file_size,
+                            bool (*define)(void *arg, const char *name),
+                            void *arg)
+{
+    struct elf_file ef;
+
+    int status = elf_file_open(&ef, file_data, file_size);
+    if (status != 0) {
+        return status;
+    }
+
+    for (uint64_t idx = 1; idx < ef.nsyms; ++idx) {
+        const Elf64_Sym *sym = elf_symbol(&ef, idx);
+        unsigned bind = ELF64_ST_BIND(sym->st_info);
+        unsigned type = ELF64_ST_TYPE(sym->st_info);
+
+        if ((bind != STB_GLOBAL && bind != STB_WEAK && bind != STB_GNU_UNIQUE) || sym->st_shndx == SHN_UNDEF) {
+            continue;
+        }
+
+        if (type == STT_SECTION || type == STT_FILE || sym->st_name == 0) {
+            continue;
+        }
+
+        if (!define(arg, elf_symbol_name(&ef, idx))) {
+            return ENOMEM;
+        }
+    }
+
+    return 0;
+}
+
+
 const struct objectfile_reader elf64_frontend = {
     .name = "Elf64",
     .probe_file = check_elf_header,
     .parse_file = parse_elf_file,
+    .parse_relocs = parse_elf_relocs,
+    .release_state = free,
+    .scan_globals = scan_elf_globals,
 };
 
 
 __attribute__((constructor))
 static void elf64_frontend_init(void)
 {
+    build_section_rule_index();
     objectfile_reader_register(&elf64_frontend);
 }
@@ -2,7 +2,7 @@
 #include "logging.h"
 #include "objectfile.h"
 #include "mfile.h"
-#include "strpool.h"
+#include "archive_reader.h"
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
@@ -14,36 +14,35 @@
 
 struct objectfile * archive_extract_member(struct archive_member *member)
 {
-    if (member->objfile == NULL) {
-        struct archive *ar = member->archive;
-        char *name = NULL;
-        const char *member_name = archive_member_name(member);
-
-        if (member_name[0] != '\0') {
-            name = malloc(strlen(ar->name) + 2 + strlen(member_name) + 1);
-            if (name != NULL) {
-                sprintf(name, "%s(%s)", ar->name, member_name);
-            }
-        } else {
-            name = malloc(strlen(ar->name) + 24);
-            if (name != NULL) {
-                sprintf(name, "%s:%lu", ar->name, member->offset);
-            }
-        }
+    if (member->objfile != NULL) {
+        return objectfile_get(member->objfile);
+    }
 
-        if (name == NULL) {
-            return NULL;
-        }
+    struct objectfile *objfile = objectfile_alloc_member(member->archive, member->offset,
+                                                         member->content, member->size);
+    if (objfile == NULL) {
+        return NULL;
+    }
 
-        member->objfile = objectfile_alloc(ar->file, name, member->content, member->size);
-        if (member->objfile == NULL) {
-            free(name);
-            return NULL;
-        }
-        free(name);
+    member->objfile = objfile;
+    member->extracted = true;
+    return objfile;
+}
+
+
+size_t archive_member_name(const struct archive_member *member, char *name, size_t len)
+{
+    const struct archive *ar = member->archive;
+
+    if (len > 0) {
+        name[0] = '\0';
     }
 
-    return objectfile_get(member->objfile);
+    if (ar->reader == NULL || ar->reader->member_name == NULL) {
+        return 0;
+    }
+
+    return ar->reader->member_name(ar->file_data, ar->file_size, member->header, name, len);
 }
 
 
@@ -72,7 +71,7 @@ struct archive_member * archive_get_member(const struct archive *ar, size_t offs
 
 
 struct archive_member * archive_add_member(struct archive *ar, 
-                                           const char *name,
+                                           size_t header,
                                            size_t offset,
                                            size_t size)
 {
@@ -112,12 +111,13 @@ struct archive_member * archive_add_member(struct archive *ar,
     }
 
     struct archive_member *member = &members[low];
-    member->name = strpool_intern(&ar->names, name);
     member->archive = ar;
+    member->header = header;
     member->offset = offset;
     member->size = size;
     member->content = ar->file_data + offset;
     member->objfile = NULL;
+    member->extracted = false;
 
     ar->members = members;
     ar->nmembers++;
@@ -132,20 +132,13 @@ void archive_put(struct archive *ar)
 
     if (--(ar->refcnt) == 0) {
 
-        if (ar->members != NULL) {
-            for (size_t i = 0; i < ar->nmembers; ++i) {
-                struct archive_member *member = &ar->members[i];
-                if (member->objfile != NULL) {
-                    objectfile_put(member->objfile);
-                }
-            }
-            free(ar->members);
-        }
+        // Extracted object files hold a reference to the archive,
+        // so there can not be any left at this point
+        free(ar->members);
         ar->members = NULL;
         ar->nmembers = 0;
         
         mfile_put(ar->file);
-        strpool_clear(&ar->names);
         free(ar->name);
         free(ar);
     }
@@ -194,12 +187,13 @@ struct archive * archive_alloc(struct mfile *file,
     }
     strcpy(ar->name, name);
 
-    memset(&ar->names, 0, sizeof(struct strpool));
     ar->file = mfile_get(file);
     ar->refcnt = 1;
     ar->file_data = file_data;
     ar->file_size = file_size;
     ar->members = NULL;
     ar->nmembers = 0;
+    ar->reader = NULL;
+    ar->has_symbol_index = false;
     return ar;
 }
@@ -2,19 +2,222 @@
 #include "archives.h"
 #include "archive.h"
 #include "logging.h"
+#include "mfile.h"
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
 #include <utils/hash.h>
 #include <utils/align.h>
+#include <utils/memacct.h>
+
+
+#define ARCHIVES_IMAGE_MAGIC        "BFLDARIX"
+#define ARCHIVES_IMAGE_VERSION      1
+
+
+/*
+ * Average number of symbols per displacement bucket.
+ * Larger buckets make the displacement array smaller,
+ * but makes it harder to find displacements.
+ */
+#define ARCHIVES_BUCKET_SIZE        2
+
+
+/*
+ * Displacements with this bit set holds the slot itself.
+ * Used for buckets with a single symbol.
+ */
+#define ARCHIVES_DIRECT_SLOT        0x80000000U
+
+
+/*
+ * Give up finding a displacement for a bucket after this many attempts.
+ */
+#define ARCHIVES_MAX_DISPLACEMENTS  (1U << 24)
+
+
+/*
+ * Header of a frozen archive index image.
+ *
+ * The header is followed by the archive entries, the displacements,
+ * the slots and finally the string table, each aligned to 8 bytes.
+ */
+struct archives_image_header
+{
+    char magic[8];              // ARCHIVES_IMAGE_MAGIC
+    uint32_t version;           // image format version
+    uint32_t narchives;         // number of archive entries
+    uint64_t nslots;            // number of slots (one per symbol)
+    uint64_t nbuckets;          // number of displacements
+    uint64_t strings_size;      // size of the string table
+};
+
+
+/*
+ * Archive entry in a frozen archive index image.
+ */
+struct archives_image_archive
+{
+    uint64_t name;              // archive name (offset into the string table)
+    uint64_t file_size;         // size of the archive file
+    int64_t mtime;              // modification time of the archive file
+};
+
+
+/*
+ * Symbol slot in a frozen archive index image.
+ */
+struct archives_image_slot
+{
+    uint32_t fingerprint;       // lower half of the symbol name hash
+    uint32_t archive;           // archive entry index
+    uint64_t name;              // symbol name (offset into the string table)
+    uint64_t member;            // offset of the archive member in the archive
+};
+
+
+/*
+ * Frozen archive index.
+ */
+struct archives_frozen
+{
+    uint8_t *image;                                 // memory image
+    size_t size;                                    // size of the memory image
+    const struct archives_image_header *header;     // pointer to the image header
+    const uint32_t *displacements;                  // pointer to the displacements
+    const struct archives_image_slot *slots;        // pointer to the slots
+    const char *strings;                            // pointer to the string table
+    struct archive_member **members;                // weak references to archive members (by slot)
+};
+
+
+/*
+ * Temporary entry used while building the perfect hash.
+ */
+struct frozen_key
+{
+    uint64_t hash;                          // 64-bit hash of the symbol name
+    const struct archive_symbol *entry;     // entry in the hash table
+    uint64_t slot;                          // assigned slot
+};
+
+
+static inline
+uint64_t frozen_reduce(uint64_t hash, uint64_t n)
+{
+    return ((hash >> 32) * n) >> 32;
+}
+
+
+static inline
+uint64_t frozen_bucket(uint64_t hash, uint64_t nbuckets)
+{
+    return frozen_reduce(hash, nbuckets);
+}
+
+
+static inline
+uint64_t frozen_slot(uint64_t hash, uint32_t displacement, uint64_t nslots)
+{
+    if (displacement & ARCHIVES_DIRECT_SLOT) {
+        return displacement & ~ARCHIVES_DIRECT_SLOT;
+    }
+
+    // SplitMix64 finalizer, so that the slot is independent of the bucket
+    uint64_t h = hash + displacement * 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h = h ^ (h >> 31);
+    return frozen_reduce(h, nslots);
+}
+
+
+/*
+ * Calculate offsets into the image from the header.
+ * Returns the total image size, or 0 if the header is invalid.
+ */
+static size_t frozen_layout(const struct archives_image_header *hdr,
+                            size_t *displacements,
+                            size_t *slots,
+                            size_t *strings)
+{
+    if (hdr->nslots >= ARCHIVES_DIRECT_SLOT || hdr->nbuckets > hdr->nslots) {
+        return 0;
+    }
+
+    if (hdr->strings_size == 0 || hdr->strings_size > (1ULL << 40)) {
+        return 0;
+    }
+
+    size_t offset = sizeof(struct archives_image_header);
+    offset += sizeof(struct archives_image_archive) * hdr->narchives;
+
+    *displacements = align_to(offset, 8);
+    offset = *displacements + sizeof(uint32_t) * hdr->nbuckets;
+
+    *slots = align_to(offset, 8);
+    offset = *slots + sizeof(struct archives_image_slot) * hdr->nslots;
+
+    *strings = offset;
+    return offset + hdr->strings_size;
+}
+
+
+static void frozen_free(struct archives_frozen *frozen)
+{
+    memacct_free(MEMACCT_ARCHIVES, frozen->members);
+    memacct_free(MEMACCT_ARCHIVES, frozen->image);
+    memacct_free(MEMACCT_ARCHIVES, frozen);
+}
+
+
+static struct archive_member * 
+frozen_find_symbol(const struct archives_frozen *frozen, const char *symbol_name)
+{
+    const struct archives_image_header *hdr = frozen->header;
+
+    uint64_t hash = hash_fnv1a_64(symbol_name, strlen(symbol_name));
+    uint32_t displacement = frozen->displacements[frozen_bucket(hash, hdr->nbuckets)];
+    uint64_t slot = frozen_slot(hash, displacement, hdr->nslots);
+
+    const struct archives_image_slot *this = &frozen->slots[slot];
+
+    if (this->fingerprint == (uint32_t) hash) {
+        if (strcmp(&frozen->strings[this->name], symbol_name) == 0) {
+            return frozen->members[slot];
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Scan the shape of the hash table.
+ */
+static void scan_table_stats(const struct archives *index, struct table_stats *stats)
+{
+    stats->capacity = index->capacity;
+    stats->entries = 0;
+    stats->max_dfi = 0;
+    stats->total_dfi = 0;
+
+    for (uint64_t i = 0; i < index->capacity; ++i) {
+        if (index->index[i].hash != 0) {
+            table_stats_entry(stats, index->index[i].dfi);
+        }
+    }
+}
 
 
 struct archives * archives_alloc(void)
 {
-    struct archives *index = malloc(sizeof(struct archives));
+    struct archives *index = memacct_malloc(MEMACCT_ARCHIVES, sizeof(struct archives));
     if (index == NULL) {
         return NULL;
     }
@@ -27,6 +230,8 @@ struct archives * archives_alloc(void)
     index->index = NULL;
     memset(&index->names, 0, sizeof(struct strpool));
     index->narchives = 0;
+    index->frozen = NULL;
+    memset(&index->stats, 0, sizeof(struct table_stats));
     return index;
 }
 
@@ -47,7 +252,7 @@ void archives_put(struct archives *index)
 
     if (--(index->refcnt) == 0) {
         archives_clear_symbols(index);
-        free(index);
+        memacct_free(MEMACCT_ARCHIVES, index);
     }
 }
 
@@ -66,7 +271,7 @@ static bool archives_rehash_symbols(struct archives *index, uint64_t capacity)
         return false;
     }
 
-    struct archive_symbol *ht = calloc(capacity, sizeof(struct archive_symbol));
+    struct archive_symbol *ht = memacct_calloc(MEMACCT_ARCHIVES, capacity, sizeof(struct archive_symbol));
     if (ht == NULL) {
         return false;
     }
@@ -96,10 +301,11 @@ static bool archives_rehash_symbols(struct archives *index, uint64_t capacity)
         }
     }
 
-    free(index->index);
+    memacct_free(MEMACCT_ARCHIVES, index->index);
     index->index = ht;
     index->capacity = capacity;
     index->rehash_threshold = (index->capacity / 4) * 3;
+    index->stats.rehashes++;
     return true;
 }
 
@@ -124,7 +330,7 @@ static bool archives_add_archive(struct archives *index, struct archive *archive
         }
     }
 
-    struct archive **a = (struct archive**) realloc(index->archives, sizeof(struct archive*) * (index->narchives + 1));
+    struct archive **a = (struct archive**) memacct_realloc(MEMACCT_ARCHIVES, index->archives, sizeof(struct archive*) * (index->narchives + 1));
     if (a == NULL) {
         return false;
     }
@@ -142,17 +348,91 @@ static bool archives_add_archive(struct archives *index, struct archive *archive
 }
 
 
-bool archives_insert_symbol(struct archives *index, struct archive_member *member, const char *symbol_name)
+/*
+ * Rebuild the hash table from a frozen index, so that symbols can be inserted again.
+ */
+static bool archives_thaw(struct archives *index)
 {
-    if (archives_find_symbol(index, symbol_name) != NULL) {
-        return true;
+    struct archives_frozen *frozen = index->frozen;
+    uint64_t entries = index->entries;
+
+    index->frozen = NULL;
+    index->entries = 0;
+
+    for (uint64_t i = 0; i < frozen->header->nslots; ++i) {
+        const char *name = &frozen->strings[frozen->slots[i].name];
+
+        if (!archives_insert_symbol(index, frozen->members[i], name)) {
+            memacct_free(MEMACCT_ARCHIVES, index->index);
+            index->index = NULL;
+            index->capacity = 0;
+            index->rehash_threshold = 0;
+            strpool_clear(&index->names);
+
+            index->entries = entries;
+            index->frozen = frozen;
+            return false;
+        }
     }
 
-    struct archive *archive = member->archive;
+    frozen_free(frozen);
+    return true;
+}
+
+
+static struct archive_member * 
+find_symbol(const struct archives *index, uint32_t hash, const char *symbol_name)
+{
+    if (index->capacity == 0) {
+        return NULL;
+    }
+
+    uint64_t mask = index->capacity - 1;
+    uint64_t slot = hash & mask;
+    uint32_t dfi =  0;
+
+    const struct archive_symbol *this = &index->index[slot];
+
+    while (this->hash != 0 && dfi <= this->dfi) {
+        if (this->hash == hash) {
+            const char *existing = strpool_at(&index->names, this->name);
+            if (strcmp(existing, symbol_name) == 0) {
+                table_stats_lookup(&index->stats, true, dfi + 1);
+                return this->member;
+            }
+        }
+
+        slot = (slot + 1) & mask;
+        this = &index->index[slot];
+        ++dfi;
+    }
+
+    table_stats_lookup(&index->stats, false, dfi + 1);
+    return NULL;
+}
+
+
+static uint32_t symbol_hash(const char *symbol_name)
+{
     uint32_t hash = hash_fnv1a_32(symbol_name, strlen(symbol_name));
     if (hash == 0) {
         hash = 1;
     }
+    return hash;
+}
+
+
+/*
+ * Insert a symbol with a precalculated hash, unless it is already in the index.
+ */
+static bool insert_symbol(struct archives *index, uint32_t hash, 
+                          struct archive_member *member, const char *symbol_name)
+{
+    if (find_symbol(index, hash, symbol_name) != NULL) {
+        return true;
+    }
+
+    struct archive *archive = member->archive;
 
     if (index->entries >= index->rehash_threshold || index->entries == index->capacity) {
         if (!archives_rehash_symbols(index, index->capacity > 0 ? index->capacity * 2 : 64)) {
@@ -205,56 +485,510 @@ bool archives_insert_symbol(struct archives *index, struct archive_member *membe
 }
 
 
+bool archives_insert_symbol(struct archives *index, struct archive_member *member, const char *symbol_name)
+{
+    if (index->frozen != NULL) {
+        if (frozen_find_symbol(index->frozen, symbol_name) != NULL) {
+            return true;
+        }
+
+        if (!archives_thaw(index)) {
+            return false;
+        }
+    }
+
+    return insert_symbol(index, symbol_hash(symbol_name), member, symbol_name);
+}
+
+
+bool archives_merge(struct archives *index, const struct archives *other)
+{
+    if (other->frozen != NULL) {
+        const struct archives_frozen *frozen = other->frozen;
+
+        for (uint64_t i = 0; i < frozen->header->nslots; ++i) {
+            const struct archives_image_slot *slot = &frozen->slots[i];
+            const char *name = &frozen->strings[slot->name];
+
+            if (!archives_insert_symbol(index, frozen->members[i], name)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    if (index->frozen != NULL && other->entries > 0) {
+        if (!archives_thaw(index)) {
+            return false;
+        }
+    }
+
+    // Reserve room up front, so we don't rehash several times while merging
+    uint64_t needed = index->entries + other->entries;
+    if (needed >= index->rehash_threshold) {
+        uint64_t capacity = index->capacity > 0 ? index->capacity : 64;
+        while ((capacity / 4) * 3 <= needed) {
+            capacity <<= 1;
+        }
+
+        if (!archives_rehash_symbols(index, capacity)) {
+            return false;
+        }
+    }
+
+    for (uint64_t i = 0; i < other->capacity; ++i) {
+        const struct archive_symbol *sym = &other->index[i];
+
+        if (sym->hash != 0) {
+            const char *name = strpool_at(&other->names, sym->name);
+
+            if (!insert_symbol(index, sym->hash, sym->member, name)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
 struct archive_member * 
 archives_find_symbol(const struct archives *index, const char *symbol_name)
 {
-    if (index->capacity == 0) {
-        return NULL;
+    if (index->frozen != NULL) {
+        struct archive_member *member = frozen_find_symbol(index->frozen, symbol_name);
+        table_stats_lookup(&index->stats, member != NULL, 1);
+        return member;
     }
 
-    uint32_t hash = hash_fnv1a_32(symbol_name, strlen(symbol_name));
-    if (hash == 0) {
-        hash = 1;
+    return find_symbol(index, symbol_hash(symbol_name), symbol_name);
+}
+
+
+static uint64_t archive_position(const struct archives *index, const struct archive *archive)
+{
+    uint64_t low = 0;
+    uint64_t high = index->narchives;
+
+    while (low < high) {
+        uint64_t mid = low + ((high - low) >> 1);
+
+        if (index->archives[mid] == archive) {
+            return mid;
+        } else if (index->archives[mid] < archive) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
     }
-    uint64_t mask = index->capacity - 1;
-    uint64_t slot = hash & mask;
-    uint32_t dfi =  0;
 
-    const struct archive_symbol *this = &index->index[slot];
+    return index->narchives;
+}
 
-    while (this->hash != 0 && dfi <= this->dfi) {
-        if (this->hash == hash) {
-            const char *existing = strpool_at(&index->names, this->name);
-            if (strcmp(existing, symbol_name) == 0) {
-                return this->member;
+
+/*
+ * Find displacements so that every symbol gets a unique slot.
+ * Buckets are placed from the largest to the smallest, while the
+ * table is still empty enough for large buckets to fit.
+ */
+static bool frozen_place(struct frozen_key *keys, uint64_t nkeys,
+                         uint32_t *displacements, uint64_t nbuckets)
+{
+    bool success = false;
+    uint64_t *taken = memacct_calloc(MEMACCT_ARCHIVES, (nkeys + 63) / 64, sizeof(uint64_t));
+    uint64_t *start = memacct_calloc(MEMACCT_ARCHIVES, nbuckets + 1, sizeof(uint64_t));
+    struct frozen_key **sorted = memacct_malloc(MEMACCT_ARCHIVES, sizeof(struct frozen_key*) * nkeys);
+    uint64_t *order = memacct_malloc(MEMACCT_ARCHIVES, sizeof(uint64_t) * nbuckets);
+    uint64_t *bysize = NULL;
+
+    if (taken == NULL || start == NULL || sorted == NULL || order == NULL) {
+        goto leave;
+    }
+
+    // Distribute keys into buckets (counting sort)
+    uint64_t maxsize = 0;
+    for (uint64_t i = 0; i < nkeys; ++i) {
+        start[frozen_bucket(keys[i].hash, nbuckets) + 1]++;
+    }
+    for (uint64_t b = 0; b < nbuckets; ++b) {
+        maxsize = start[b + 1] > maxsize ? start[b + 1] : maxsize;
+        start[b + 1] += start[b];
+        order[b] = start[b];
+    }
+    for (uint64_t i = 0; i < nkeys; ++i) {
+        sorted[order[frozen_bucket(keys[i].hash, nbuckets)]++] = &keys[i];
+    }
+
+    // Order buckets by size, largest first (counting sort)
+    bysize = memacct_calloc(MEMACCT_ARCHIVES, maxsize + 2, sizeof(uint64_t));
+    if (bysize == NULL) {
+        goto leave;
+    }
+    for (uint64_t b = 0; b < nbuckets; ++b) {
+        bysize[maxsize - (start[b + 1] - start[b]) + 1]++;
+    }
+    for (uint64_t n = 0; n <= maxsize; ++n) {
+        bysize[n + 1] += bysize[n];
+    }
+    for (uint64_t b = 0; b < nbuckets; ++b) {
+        order[bysize[maxsize - (start[b + 1] - start[b])]++] = b;
+    }
+
+    uint64_t next_free = 0;
+
+    for (uint64_t i = 0; i < nbuckets; ++i) {
+        uint64_t b = order[i];
+        uint64_t first = start[b];
+        uint64_t size = start[b + 1] - first;
+
+        if (size == 0) {
+            displacements[b] = 0;
+            continue;
+        }
+
+        if (size == 1) {
+            // Single symbol buckets are placed directly in the next free slot
+            while (taken[next_free >> 6] & (1ULL << (next_free & 63))) {
+                ++next_free;
             }
+            sorted[first]->slot = next_free;
+            taken[next_free >> 6] |= 1ULL << (next_free & 63);
+            displacements[b] = ARCHIVES_DIRECT_SLOT | next_free;
+            continue;
         }
 
-        slot = (slot + 1) & mask;
-        this = &index->index[slot];
-        ++dfi;
+        uint32_t d;
+        for (d = 0; d < ARCHIVES_MAX_DISPLACEMENTS; ++d) {
+            uint64_t k;
+
+            for (k = 0; k < size; ++k) {
+                uint64_t slot = frozen_slot(sorted[first + k]->hash, d, nkeys);
+                if (taken[slot >> 6] & (1ULL << (slot & 63))) {
+                    break;
+                }
+                sorted[first + k]->slot = slot;
+                taken[slot >> 6] |= 1ULL << (slot & 63);
+            }
+
+            if (k == size) {
+                break;
+            }
+
+            // Collision, undo the slots we took
+            while (k-- > 0) {
+                uint64_t slot = sorted[first + k]->slot;
+                taken[slot >> 6] &= ~(1ULL << (slot & 63));
+            }
+        }
+
+        if (d == ARCHIVES_MAX_DISPLACEMENTS) {
+            log_debug("Unable to find displacement for archive index bucket %llu", b);
+            goto leave;
+        }
+
+        displacements[b] = d;
     }
 
-    return NULL;
+    success = true;
+
+leave:
+    memacct_free(MEMACCT_ARCHIVES, bysize);
+    memacct_free(MEMACCT_ARCHIVES, order);
+    memacct_free(MEMACCT_ARCHIVES, sorted);
+    memacct_free(MEMACCT_ARCHIVES, start);
+    memacct_free(MEMACCT_ARCHIVES, taken);
+    return success;
+}
+
+
+bool archives_freeze(struct archives *index)
+{
+    if (index->frozen != NULL || index->entries == 0) {
+        return true;
+    }
+
+    if (index->entries >= ARCHIVES_DIRECT_SLOT || index->narchives > UINT32_MAX) {
+        return false;
+    }
+
+    struct archives_frozen *frozen = memacct_calloc(MEMACCT_ARCHIVES, 1, sizeof(struct archives_frozen));
+    if (frozen == NULL) {
+        return false;
+    }
+
+    struct archives_image_header hdr = {
+        .magic = ARCHIVES_IMAGE_MAGIC,
+        .version = ARCHIVES_IMAGE_VERSION,
+        .narchives = index->narchives,
+        .nslots = index->entries,
+        .nbuckets = (index->entries + ARCHIVES_BUCKET_SIZE - 1) / ARCHIVES_BUCKET_SIZE,
+        .strings_size = index->names.offset,
+    };
+
+    for (uint64_t i = 0; i < index->narchives; ++i) {
+        hdr.strings_size += strlen(index->archives[i]->name) + 1;
+    }
+
+    size_t displacements = 0, slots = 0, strings = 0;
+    frozen->size = frozen_layout(&hdr, &displacements, &slots, &strings);
+    frozen->image = memacct_calloc(MEMACCT_ARCHIVES, 1, frozen->size);
+    frozen->members = memacct_malloc(MEMACCT_ARCHIVES, sizeof(struct archive_member*) * hdr.nslots);
+
+    struct frozen_key *keys = memacct_malloc(MEMACCT_ARCHIVES, sizeof(struct frozen_key) * hdr.nslots);
+
+    if (frozen->size == 0 || frozen->image == NULL || frozen->members == NULL || keys == NULL) {
+        memacct_free(MEMACCT_ARCHIVES, keys);
+        frozen_free(frozen);
+        return false;
+    }
+
+    uint64_t nkeys = 0;
+    for (uint64_t i = 0; i < index->capacity; ++i) {
+        const struct archive_symbol *entry = &index->index[i];
+
+        if (entry->hash != 0) {
+            const char *name = strpool_at(&index->names, entry->name);
+            keys[nkeys].hash = hash_fnv1a_64(name, strlen(name));
+            keys[nkeys].entry = entry;
+            keys[nkeys].slot = 0;
+            ++nkeys;
+        }
+    }
+    assert(nkeys == hdr.nslots);
+
+    uint8_t *image = frozen->image;
+    uint32_t *disp = (uint32_t*) (image + displacements);
+
+    if (!frozen_place(keys, nkeys, disp, hdr.nbuckets)) {
+        memacct_free(MEMACCT_ARCHIVES, keys);
+        frozen_free(frozen);
+        return false;
+    }
+
+    // Build the memory image
+    memcpy(image, &hdr, sizeof(hdr));
+
+    char *strtab = (char*) (image + strings);
+    memcpy(strtab, index->names.strings, index->names.offset);
+
+    uint64_t offset = index->names.offset;
+    struct archives_image_archive *archives = (struct archives_image_archive*) (image + sizeof(hdr));
+
+    for (uint64_t i = 0; i < index->narchives; ++i) {
+        const struct archive *ar = index->archives[i];
+        size_t len = strlen(ar->name) + 1;
+
+        archives[i].name = offset;
+        archives[i].file_size = ar->file_size;
+        archives[i].mtime = ar->file != NULL ? ar->file->mtime : 0;
+
+        memcpy(&strtab[offset], ar->name, len);
+        offset += len;
+    }
+
+    struct archives_image_slot *slottab = (struct archives_image_slot*) (image + slots);
+
+    for (uint64_t i = 0; i < nkeys; ++i) {
+        const struct archive_symbol *entry = keys[i].entry;
+        struct archives_image_slot *slot = &slottab[keys[i].slot];
+
+        slot->fingerprint = (uint32_t) keys[i].hash;
+        slot->archive = archive_position(index, entry->member->archive);
+        slot->name = entry->name;
+        slot->member = entry->member->offset;
+        frozen->members[keys[i].slot] = entry->member;
+    }
+    memacct_free(MEMACCT_ARCHIVES, keys);
+
+    frozen->header = (const struct archives_image_header*) image;
+    frozen->displacements = disp;
+    frozen->slots = slottab;
+    frozen->strings = strtab;
+
+    // The hash table and the string pool are no longer needed
+    scan_table_stats(index, &index->stats);
+    memacct_free(MEMACCT_ARCHIVES, index->index);
+    index->index = NULL;
+    index->capacity = 0;
+    index->rehash_threshold = 0;
+    strpool_clear(&index->names);
+
+    index->frozen = frozen;
+
+    log_debug("Froze archive index with %llu symbols (%zu bytes)", hdr.nslots, frozen->size);
+    return true;
+}
+
+
+bool archives_save_frozen(const struct archives *index, const char *pathname)
+{
+    const struct archives_frozen *frozen = index->frozen;
+
+    if (frozen == NULL) {
+        log_error("Archive index must be frozen before it can be saved");
+        return false;
+    }
+
+    size_t len = strlen(pathname) + 32;
+    char tmpname[len];
+    snprintf(tmpname, len, "%s.%ld.tmp", pathname, (long) getpid());
+
+    FILE *fp = fopen(tmpname, "wb");
+    if (fp == NULL) {
+        log_warning("Unable to write archive index cache '%s'", pathname);
+        return false;
+    }
+
+    size_t written = fwrite(frozen->image, 1, frozen->size, fp);
+    if (fclose(fp) != 0 || written != frozen->size) {
+        log_warning("Unable to write archive index cache '%s'", pathname);
+        remove(tmpname);
+        return false;
+    }
+
+    // Replace the file atomically, so that readers never see a partial image
+    if (rename(tmpname, pathname) != 0) {
+        log_warning("Unable to write archive index cache '%s'", pathname);
+        remove(tmpname);
+        return false;
+    }
+
+    return true;
+}
+
+
+bool archives_load_frozen(struct archives *index,
+                          struct archive **archives,
+                          size_t narchives,
+                          const uint8_t *image,
+                          size_t size)
+{
+    struct archives_image_header hdr;
+
+    if (size < sizeof(hdr)) {
+        return false;
+    }
+    memcpy(&hdr, image, sizeof(hdr));
+
+    if (memcmp(hdr.magic, ARCHIVES_IMAGE_MAGIC, sizeof(hdr.magic)) != 0) {
+        return false;
+    }
+
+    if (hdr.version != ARCHIVES_IMAGE_VERSION) {
+        log_debug("Archive index cache has unsupported version %u", hdr.version);
+        return false;
+    }
+
+    size_t displacements = 0, slots = 0, strings = 0;
+    if (frozen_layout(&hdr, &displacements, &slots, &strings) != size) {
+        log_debug("Archive index cache is truncated");
+        return false;
+    }
+
+    const char *strtab = (const char*) (image + strings);
+    if (strtab[hdr.strings_size - 1] != '\0') {
+        return false;
+    }
+
+    // Match archive entries with the given archives
+    const struct archives_image_archive *entries = (const void*) (image + sizeof(hdr));
+    struct archive *map[hdr.narchives > 0 ? hdr.narchives : 1];
+
+    for (uint32_t i = 0; i < hdr.narchives; ++i) {
+        const struct archives_image_archive *entry = &entries[i];
+        map[i] = NULL;
+
+        if (entry->name >= hdr.strings_size) {
+            return false;
+        }
+
+        for (size_t j = 0; j < narchives && map[i] == NULL; ++j) {
+            struct archive *ar = archives[j];
+            int64_t mtime = ar->file != NULL ? ar->file->mtime : 0;
+
+            if (ar->file_size == entry->file_size && mtime == entry->mtime
+                    && strcmp(ar->name, &strtab[entry->name]) == 0) {
+                map[i] = ar;
+            }
+        }
+
+        if (map[i] == NULL) {
+            log_debug("Archive index cache is stale for archive %s", &strtab[entry->name]);
+            return false;
+        }
+    }
+
+    // Look up members before modifying the index
+    const struct archives_image_slot *slottab = (const void*) (image + slots);
+    struct archive_member **members = memacct_malloc(MEMACCT_ARCHIVES, sizeof(struct archive_member*) * (hdr.nslots + 1));
+    if (members == NULL) {
+        return false;
+    }
+
+    for (uint64_t i = 0; i < hdr.nslots; ++i) {
+        const struct archives_image_slot *slot = &slottab[i];
+
+        if (slot->archive >= hdr.narchives || slot->name >= hdr.strings_size) {
+            memacct_free(MEMACCT_ARCHIVES, members);
+            return false;
+        }
+
+        members[i] = archive_get_member(map[slot->archive], slot->member);
+        if (members[i] == NULL) {
+            log_debug("Archive index cache refers to unknown archive member");
+            memacct_free(MEMACCT_ARCHIVES, members);
+            return false;
+        }
+    }
+
+    for (uint64_t i = 0; i < hdr.nslots; ++i) {
+        if (!archives_insert_symbol(index, members[i], &strtab[slottab[i].name])) {
+            memacct_free(MEMACCT_ARCHIVES, members);
+            return false;
+        }
+    }
+
+    memacct_free(MEMACCT_ARCHIVES, members);
+    return true;
+}
+
+
+void archives_table_stats(const struct archives *index, struct table_stats *stats)
+{
+    *stats = index->stats;
+
+    if (index->capacity > 0) {
+        scan_table_stats(index, stats);
+    }
 }
 
 
 void archives_clear_symbols(struct archives *index)
 {
+    if (index->frozen != NULL) {
+        frozen_free(index->frozen);
+        index->frozen = NULL;
+    }
+
     if (index->archives != NULL) {
         for (uint64_t i = 0; i < index->narchives; ++i) {
             struct archive *ar = index->archives[i];
             archive_put(ar);
         }
         index->narchives = 0;
-        free(index->archives);
+        memacct_free(MEMACCT_ARCHIVES, index->archives);
         index->archives = NULL;
     }
 
+    if (index->capacity > 0) {
+        scan_table_stats(index, &index->stats);
+    }
+
     strpool_clear(&index->names);
     index->capacity = 0;
     index->entries = 0;
-    free(index->index);
+    memacct_free(MEMACCT_ARCHIVES, index->index);
     index->index = NULL;
     index->rehash_threshold = 0;
 }
@@ -3,6 +3,7 @@
 #include "logging.h"
 #include "utils/hash.h"
 #include "utils/align.h"
+#include "utils/memacct.h"
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -12,6 +13,29 @@
 #include <errno.h>
 
 
+/*
+ * Insert an entry into a table that is known not to contain it.
+ */
+static void insert_entry(struct global *table, uint64_t capacity, struct global current)
+{
+    current.dfi = 0;
+    uint64_t slot = current.hash & (capacity - 1);
+
+    while (current.hash != 0) {
+        struct global *this = &table[slot];
+
+        if (this->hash == 0 || current.dfi > this->dfi) {
+            struct global tmp = *this;
+            *this = current;
+            current = tmp;
+        }
+
+        slot = (slot + 1) & (capacity - 1);
+        current.dfi++;
+    }
+}
+
+
 static bool rehash(struct globals *g)
 {
     uint64_t capacity = g->capacity > 0 ? g->capacity * 2 : 128;
@@ -20,39 +44,22 @@ static bool rehash(struct globals *g)
         return false;
     }
 
-    struct global *table = (struct global*) calloc(capacity, sizeof(struct global));
+    struct global *table = (struct global*) memacct_calloc(MEMACCT_GLOBALS, capacity, sizeof(struct global));
     if (table == NULL) {
         return false;
     }
 
     for (uint64_t i = 0; i < g->capacity; ++i) {
-        struct global current = g->table[i];
-
-        if (current.hash == 0) {
-            continue;
-        }
-
-        current.dfi = 0;
-        uint64_t slot = current.hash & (capacity - 1);
-
-        while (current.hash != 0) {
-            struct global *this = &table[slot];
-
-            if (this->hash == 0 || current.dfi > this->dfi) {
-                struct global tmp = *this;
-                *this = current;
-                current = tmp;
-            }
-
-            slot = (slot + 1) & (capacity - 1);
-            current.dfi++;
+        if (g->table[i].hash != 0) {
+            insert_entry(table, capacity, g->table[i]);
         }
     }
 
-    free(g->table);
+    memacct_free(MEMACCT_GLOBALS, g->table);
     g->table = table;
     g->capacity = capacity;
     g->rehash_threshold = GLOBALS_REHASH_THRESHOLD(capacity);
+    g->stats.rehashes++;
     return true;
 }
 
@@ -142,11 +149,15 @@ void globals_remove_symbol(struct globals *g, const struct symbol *symbol)
     if (this->hash != 0 && dfi <= this->dfi) {
         g->nglobals--;
 
-        struct global *next = &g->table[(slot + 1) & (g->capacity - 1)];
+        // Shift following entries back, until an entry is in its ideal slot
+        slot = (slot + 1) & (g->capacity - 1);
+        struct global *next = &g->table[slot];
         while (next->hash != 0 && next->dfi != 0) {
             *this = *next;
             this->dfi--;
             this = next;
+            slot = (slot + 1) & (g->capacity - 1);
+            next = &g->table[slot];
         }
 
         this->hash = 0;
@@ -156,6 +167,74 @@ void globals_remove_symbol(struct globals *g, const struct symbol *symbol)
 }
 
 
+uint64_t globals_remove_unused_symbols(struct globals *g)
+{
+    uint64_t nused = 0;
+
+    for (uint64_t i = 0; i < g->capacity; ++i) {
+        if (g->table[i].hash != 0 && symbol_is_alive(g->table[i].symbol)) {
+            ++nused;
+        }
+    }
+
+    if (nused == g->nglobals) {
+        return 0;
+    }
+
+    // Rebuild the table at the smallest capacity that fits the used symbols
+    uint64_t capacity = 128;
+    while (nused >= GLOBALS_REHASH_THRESHOLD(capacity)) {
+        capacity *= 2;
+    }
+
+    struct global *table = (struct global*) memacct_calloc(MEMACCT_GLOBALS, capacity, sizeof(struct global));
+    if (table == NULL) {
+        return 0;
+    }
+
+    uint64_t nremoved = 0;
+
+    for (uint64_t i = 0; i < g->capacity; ++i) {
+        struct global *this = &g->table[i];
+
+        if (this->hash == 0) {
+            continue;
+        }
+
+        if (symbol_is_alive(this->symbol)) {
+            insert_entry(table, capacity, *this);
+        } else {
+            symbol_put(this->symbol);
+            ++nremoved;
+        }
+    }
+
+    memacct_free(MEMACCT_GLOBALS, g->table);
+    g->table = table;
+    g->capacity = capacity;
+    g->nglobals = nused;
+    g->rehash_threshold = GLOBALS_REHASH_THRESHOLD(capacity);
+    g->stats.rehashes++;
+    return nremoved;
+}
+
+
+void globals_table_stats(const struct globals *g, struct table_stats *stats)
+{
+    *stats = g->stats;
+    stats->capacity = g->capacity;
+    stats->entries = 0;
+    stats->max_dfi = 0;
+    stats->total_dfi = 0;
+
+    for (uint64_t i = 0; i < g->capacity; ++i) {
+        if (g->table[i].hash != 0) {
+            table_stats_entry(stats, g->table[i].dfi);
+        }
+    }
+}
+
+
 void globals_clear(struct globals *g)
 {
     for (uint64_t i = 0; g->nglobals > 0 && i < g->capacity; ++i) {
@@ -165,7 +244,7 @@ void globals_clear(struct globals *g)
             g->nglobals--;
         }
     }
-    free(g->table);
+    memacct_free(MEMACCT_GLOBALS, g->table);
     g->table = NULL;
     g->rehash_threshold = 0;
     g->capacity = 0;
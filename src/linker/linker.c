@@ -2,11 +2,15 @@
 #include "objectfile_reader.h"
 #include "archive_reader.h"
 #include "logging.h"
+#include "trace.h"
 #include "linker.h"
 #include "groups.h"
 #include "objectfile.h"
 #include "utils/list.h"
 #include "utils/align.h"
+#include "utils/hash.h"
+#include "utils/deque.h"
+#include "utils/threadpool.h"
 #include "sections.h"
 #include "section.h"
 #include "symbols.h"
@@ -19,11 +23,108 @@
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
+#include <unistd.h>
+#include <limits.h>
+#include <stdio.h>
 
 
-int log_level = 2;  // initial log level
-int log_ctx = 0;    // initial log context
-log_ctx_t log_ctx_stack[LOG_CTX_MAX] = {0};
+/*
+ * Work shared between threads by parallel_for().
+ */
+struct parallel_work
+{
+    void (*func)(void *data, uint64_t idx);
+    void *data;
+    struct log_buffer *logs;    // messages captured for every work item (NULL if not captured)
+};
+
+
+static void parallel_job(void *arg, uint64_t idx)
+{
+    struct parallel_work *work = arg;
+
+    if (work->logs != NULL) {
+        struct log_buffer *previous = log_capture(&work->logs[idx]);
+        work->func(work->data, idx);
+        log_capture(previous);
+    } else {
+        work->func(work->data, idx);
+    }
+}
+
+
+/*
+ * Get the thread pool of the linker context, creating it on first use.
+ * Returns NULL if the pool could not be created, in which case work
+ * is simply done by the calling thread.
+ */
+static struct threadpool * linker_threadpool(struct linkerctx *ctx)
+{
+    if (ctx->pool == NULL) {
+        ctx->pool = threadpool_alloc(ctx->threads);
+        if (ctx->pool == NULL) {
+            log_warning("Unable to create worker threads, running single-threaded");
+            ctx->threads = 1;
+        }
+    }
+    return ctx->pool;
+}
+
+
+/*
+ * Call func for every index in [0, n) on the linker's thread pool.
+ * Every index is its own task (grain size 1), since the work items 
+ * are files and archive members of very different sizes.
+ *
+ * Log messages are captured for every index and written
+ * out in index order when all work is done, so that the
+ * output does not depend on how work was scheduled.
+ */
+static void parallel_for(struct linkerctx *ctx, uint64_t n, void (*func)(void *data, uint64_t idx), void *data)
+{
+    struct parallel_work work = {
+        .func = func,
+        .data = data,
+        .logs = n > 0 ? calloc(n, sizeof(struct log_buffer)) : NULL
+    };
+
+    struct threadpool *pool = ctx->threads != 1 ? linker_threadpool(ctx) : NULL;
+    threadpool_parallel_for(pool, n, 1, parallel_job, &work);
+
+    if (work.logs != NULL) {
+        for (uint64_t i = 0; i < n; ++i) {
+            log_buffer_flush(&work.logs[i]);
+        }
+        free(work.logs);
+    }
+}
+
+
+/*
+ * Object file waiting for its relocations to be loaded (second phase).
+ */
+struct pending_file
+{
+    struct objectfile *objfile;                 // strong reference to the object file
+    const struct objectfile_reader *reader;     // front-end used to load the file
+    void *state;                                // front-end handle for the file (owned)
+    struct section_table sections;              // sections that were kept, indexed like in the file
+    struct symbol **remap;                      // resolved symbols, indexed like in the file (weak references)
+    uint64_t nremap;                            // number of entries in remap
+    int status;
+};
+
+
+static void pending_file_free(struct pending_file *file)
+{
+    section_table_clear(&file->sections);
+    if (file->state != NULL && file->reader->release_state != NULL) {
+        file->reader->release_state(file->state);
+    }
+    objectfile_put(file->objfile);
+    free(file->remap);
+    free(file);
+}
 
 
 struct linkerctx * linker_alloc(const char *name, uint32_t target)
@@ -60,6 +161,14 @@ struct linkerctx * linker_alloc(const char *name, uint32_t target)
     memset(&ctx->archives, 0, sizeof(struct archives));
 
     memset(&ctx->groups, 0, sizeof(struct groups));
+    ctx->index_cache = NULL;
+    ctx->pending = NULL;
+    ctx->npending = 0;
+    ctx->strip = STRIP_NONE;
+    ctx->nobjectfiles = 0;
+    ctx->nextracted = 0;
+    ctx->threads = 0;
+    ctx->pool = NULL;
 
     ctx->target_march = target;
     ctx->target_ptr_size = backend->pointer_size;
@@ -94,6 +203,11 @@ void linker_put(struct linkerctx *ctx)
         struct section *sect;
         log_trace("Destroying linker context");
 
+        for (uint64_t i = 0; i < ctx->npending; ++i) {
+            pending_file_free(ctx->pending[i]);
+        }
+        free(ctx->pending);
+
         while ((sect = sections_pop(&ctx->sections)) != NULL) {
             // FIXME: this is necessary because of circular ownership (sect -> reloc -> sym -> sect)
             // FIXME: in a future version, use arena allocator on linkerctx for sections and symbols
@@ -141,6 +255,8 @@ void linker_put(struct linkerctx *ctx)
 
         strpool_put(ctx->strings);
 
+        threadpool_free(ctx->pool);
+
         if (ctx->name != NULL) {
             free(ctx->name);
         }
@@ -158,63 +274,514 @@ struct linkerctx * linker_get(struct linkerctx *ctx)
 }
 
 
-bool linker_read_archive(struct linkerctx *ctx, 
-                         struct archive *archive,
-                         const struct archive_reader *reader)
+/*
+ * Archive parsed into a partial index of its own.
+ */
+struct archive_job
+{
+    struct archive *archive;
+    const struct archive_reader *reader;
+    const char *index_cache;    // index cache directory (NULL if disabled)
+    struct archives partial;    // symbols provided by this archive only
+    bool needs_scan;            // archive has no symbol index, members must be scanned
+    int status;
+};
+
+
+/*
+ * Defined global symbol names found by scanning an archive member.
+ */
+struct member_scan
+{
+    struct archive_member *member;
+    char *names;                // NUL-terminated names, one after another
+    size_t size;
+    size_t capacity;
+    int status;
+};
+
+
+/*
+ * Path of the cached symbol index for an archive without one.
+ * The cached image itself records the archive name, size 
+ * and modification time, and is rejected if they do not match.
+ */
+static void index_cache_path(char *buf, size_t len, const char *dir, const struct archive *archive)
+{
+    uint64_t key = hash_fnv1a_64(archive->name, strlen(archive->name));
+    snprintf(buf, len, "%s/%016llx.idx", dir, (unsigned long long) key);
+}
+
+
+static bool load_index_cache(struct archive_job *job)
 {
+    char path[PATH_MAX];
+    struct mfile *file = NULL;
+
+    index_cache_path(path, sizeof(path), job->index_cache, job->archive);
+
+    if (access(path, R_OK) != 0 || mfile_open_read(&file, path) != 0) {
+        return false;
+    }
+
+    bool success = archives_load_frozen(&job->partial, &job->archive, 1, file->data, file->size);
+    mfile_put(file);
+
+    if (success) {
+        log_debug("Using cached symbol index '%s'", path);
+    }
+    return success;
+}
+
+
+static void save_index_cache(struct archive_job *job)
+{
+    char path[PATH_MAX];
+
+    index_cache_path(path, sizeof(path), job->index_cache, job->archive);
+
+    if (!archives_freeze(&job->partial)) {
+        log_debug("Unable to freeze symbol index, not caching it");
+        return;
+    }
+
+    if (archives_save_frozen(&job->partial, path)) {
+        log_debug("Wrote symbol index to cache '%s'", path);
+    }
+}
+
+
+static void read_archive_job(void *data, uint64_t idx)
+{
+    struct archive_job *job = &((struct archive_job*) data)[idx];
+    struct archive *archive = job->archive;
+    struct trace_span span = trace_begin("read archive");
+
     int current_log_ctx = log_ctx_new(archive->name);
 
-    if (reader == NULL) {
-        reader = archive_reader_probe(archive->file_data, archive->file_size);
+    if (job->reader == NULL) {
+        job->reader = archive_reader_probe(archive->file_data, archive->file_size);
     }
 
-    if (reader == NULL) {
+    if (job->reader == NULL) {
         log_error("Unrecognized file format");
+        job->status = EINVAL;
         log_ctx_pop();
-        return false;
+        trace_end(&span, archive->name);
+        return;
     }
 
-    log_trace("Reading archive using reader '%s'", reader->name);
+    log_trace("Reading archive using reader '%s'", job->reader->name);
+    archive->reader = job->reader;
 
-    uint64_t before = ctx->archives.entries;
-    int status = reader->parse_file(archive->file_data, archive->file_size, 
-                                    archive, &ctx->archives);
+    job->status = job->reader->parse_file(archive->file_data, archive->file_size, 
+                                          archive, &job->partial);
     while (log_ctx > current_log_ctx) {
         log_warning("Unwinding log context stack");
         log_ctx_pop();
     }
 
-    if (status != 0) {
-        log_error("Failed to read archive file: %d", status);
-        log_ctx_pop();
-        return false;
+    if (job->status == 0 && !archive->has_symbol_index && archive->nmembers > 0) {
+        job->needs_scan = job->index_cache == NULL || !load_index_cache(job);
     }
-    
-    uint64_t after = ctx->archives.entries;
-    
-    if (after - before == 0) {
-        log_notice("Archive does not provide any additional symbols");
+
+    log_ctx_pop();
+    trace_end(&span, archive->name);
+}
+
+
+static bool scan_member_define(void *arg, const char *name)
+{
+    struct member_scan *scan = arg;
+    size_t len = strlen(name) + 1;
+
+    if (scan->capacity - scan->size < len) {
+        size_t capacity = scan->capacity > 0 ? scan->capacity * 2 : 256;
+        while (capacity - scan->size < len) {
+            capacity *= 2;
+        }
+
+        char *names = realloc(scan->names, capacity);
+        if (names == NULL) {
+            return false;
+        }
+        scan->names = names;
+        scan->capacity = capacity;
+    }
+
+    memcpy(scan->names + scan->size, name, len);
+    scan->size += len;
+    return true;
+}
+
+
+/*
+ * Format the log context name of an archive member.
+ * Only called if a message is emitted while scanning the member.
+ */
+static const char * member_log_name(void *arg)
+{
+    static _Thread_local char name[512];
+    const struct archive_member *member = arg;
+
+    int n = snprintf(name, sizeof(name), "%s(", member->archive->name);
+    if (n > 0 && (size_t) n < sizeof(name) - 1) {
+        archive_member_name(member, name + n, sizeof(name) - n - 1);
+        n += strlen(name + n);
+        snprintf(name + n, sizeof(name) - n, ")");
+    }
+
+    return name;
+}
+
+
+static void scan_member_job(void *data, uint64_t idx)
+{
+    struct member_scan *scan = &((struct member_scan*) data)[idx];
+    struct archive_member *member = scan->member;
+    struct trace_span span = trace_begin("scan member");
+
+    log_ctx_new_lazy(member_log_name, member);
+
+    const struct objectfile_reader *reader = objectfile_reader_probe(member->content, member->size, NULL);
+
+    if (reader == NULL) {
+        log_debug("Skipping archive member with unrecognized format");
+    } else if (reader->scan_globals == NULL) {
+        log_debug("Object file reader '%s' can not scan for symbols", reader->name);
     } else {
-        log_debug("Archive provides %llu new symbols", after - before);
+        scan->status = reader->scan_globals(member->content, member->size, 
+                                            scan_member_define, scan);
     }
 
-    log_trace("Parsed archive file");
     log_ctx_pop();
+    trace_end(&span, trace_enabled ? member_log_name(member) : NULL);
+}
+
+
+/*
+ * Build symbol indexes for archives without one, by scanning 
+ * the members of all such archives in parallel. Symbols are 
+ * inserted in member order, so that if several members define
+ * the same symbol, the first member wins like it would with a
+ * symbol index created by ranlib.
+ */
+static void scan_archives(struct linkerctx *ctx, struct archive_job *jobs, size_t narchives)
+{
+    size_t nmembers = 0;
+
+    for (size_t i = 0; i < narchives; ++i) {
+        if (jobs[i].needs_scan) {
+            nmembers += jobs[i].archive->nmembers;
+        }
+    }
+
+    if (nmembers == 0) {
+        return;
+    }
+
+    struct member_scan *scans = calloc(nmembers, sizeof(struct member_scan));
+    if (scans == NULL) {
+        log_fatal("Unable to allocate memory");
+        for (size_t i = 0; i < narchives; ++i) {
+            if (jobs[i].needs_scan) {
+                jobs[i].status = ENOMEM;
+            }
+        }
+        return;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < narchives; ++i) {
+        if (jobs[i].needs_scan) {
+            for (size_t j = 0; j < jobs[i].archive->nmembers; ++j) {
+                scans[n++].member = &jobs[i].archive->members[j];
+            }
+        }
+    }
+
+    parallel_for(ctx, nmembers, scan_member_job, scans);
+
+    n = 0;
+    for (size_t i = 0; i < narchives; ++i) {
+        struct archive_job *job = &jobs[i];
+
+        if (!job->needs_scan) {
+            continue;
+        }
+
+        log_ctx_new(job->archive->name);
+
+        for (size_t j = 0; j < job->archive->nmembers; ++j, ++n) {
+            struct member_scan *scan = &scans[n];
+
+            if (job->status == 0 && scan->status != 0) {
+                char name[256];
+                archive_member_name(scan->member, name, sizeof(name));
+                log_error("Failed to scan archive member '%s': %d", name, scan->status);
+                job->status = scan->status;
+            }
+
+            for (size_t pos = 0; job->status == 0 && pos < scan->size; ) {
+                const char *name = scan->names + pos;
+
+                if (!archives_insert_symbol(&job->partial, scan->member, name)) {
+                    job->status = ENOMEM;
+                }
+                pos += strlen(name) + 1;
+            }
+
+            free(scan->names);
+        }
+
+        if (job->status == 0) {
+            log_debug("Indexed %llu symbols by scanning %zu archive members",
+                    job->partial.entries, job->archive->nmembers);
+
+            if (job->index_cache != NULL) {
+                save_index_cache(job);
+            }
+        }
+
+        log_ctx_pop();
+    }
+
+    free(scans);
+}
+
+
+static bool read_archives(struct linkerctx *ctx, struct archive_job *jobs, size_t narchives)
+{
+    bool success = true;
+    struct trace_span span = trace_begin("read archives");
+
+    for (size_t i = 0; i < narchives; ++i) {
+        jobs[i].index_cache = ctx->index_cache;
+    }
+
+    parallel_for(ctx, narchives, read_archive_job, jobs);
+
+    scan_archives(ctx, jobs, narchives);
+
+    // Merge in the order the archives were given, so that the 
+    // first archive providing a symbol wins, like it would if 
+    // the archives were read one by one
+    struct trace_span merge = trace_begin("merge archive indexes");
+
+    for (size_t i = 0; i < narchives; ++i) {
+        struct archive_job *job = &jobs[i];
+
+        log_ctx_new(job->archive->name);
+
+        if (success && job->status != 0) {
+            if (job->reader != NULL) {
+                log_error("Failed to read archive file: %d", job->status);
+            }
+            success = false;
+        }
+
+        if (success) {
+            uint64_t before = ctx->archives.entries;
+
+            if (!archives_merge(&ctx->archives, &job->partial)) {
+                log_error("Failed to merge archive symbol index");
+                success = false;
+            } else {
+                uint64_t after = ctx->archives.entries;
+
+                if (after - before == 0) {
+                    log_notice("Archive does not provide any additional symbols");
+                } else {
+                    log_debug("Archive provides %llu new symbols", after - before);
+                }
+
+                log_trace("Parsed archive file");
+            }
+        }
+
+        archives_clear_symbols(&job->partial);
+        log_ctx_pop();
+    }
+
+    trace_end(&merge, NULL);
+    trace_end(&span, NULL);
+    return success;
+}
+
+
+bool linker_read_archive(struct linkerctx *ctx, 
+                         struct archive *archive,
+                         const struct archive_reader *reader)
+{
+    struct archive_job job = {
+        .archive = archive,
+        .reader = reader,
+        .status = 0
+    };
+
+    return read_archives(ctx, &job, 1);
+}
+
+
+bool linker_read_archives(struct linkerctx *ctx,
+                          struct archive **archives,
+                          size_t narchives)
+{
+    if (narchives == 0) {
+        return true;
+    }
+
+    struct archive_job *jobs = calloc(narchives, sizeof(struct archive_job));
+    if (jobs == NULL) {
+        log_fatal("Unable to allocate memory");
+        return false;
+    }
+
+    for (size_t i = 0; i < narchives; ++i) {
+        jobs[i].archive = archives[i];
+        jobs[i].reader = NULL;
+        jobs[i].status = 0;
+    }
+
+    bool success = read_archives(ctx, jobs, narchives);
+    free(jobs);
+    return success;
+}
+
+
+/*
+ * Defer loading relocations for a file until all files are loaded.
+ * This takes over the front-end state, the section table and the 
+ * remap array.
+ */
+static bool add_pending_file(struct linkerctx *ctx,
+                             struct objectfile *objfile,
+                             const struct objectfile_reader *reader,
+                             void *state,
+                             const struct section_table *sections,
+                             struct symbol **remap,
+                             uint64_t nremap)
+{
+    if ((ctx->npending & (ctx->npending - 1)) == 0) {
+        uint64_t capacity = ctx->npending > 0 ? ctx->npending * 2 : 16;
+        struct pending_file **pending = realloc(ctx->pending, sizeof(struct pending_file*) * capacity);
+        if (pending == NULL) {
+            return false;
+        }
+        ctx->pending = pending;
+    }
+
+    struct pending_file *file = malloc(sizeof(struct pending_file));
+    if (file == NULL) {
+        return false;
+    }
+
+    file->objfile = objectfile_get(objfile);
+    file->reader = reader;
+    file->state = state;
+    file->sections = *sections;
+    file->remap = remap;
+    file->nremap = nremap;
+    file->status = 0;
+
+    ctx->pending[ctx->npending++] = file;
     return true;
 }
 
 
+/*
+ * Object file names are formatted on first use, so only 
+ * look them up if a message is emitted.
+ */
+static const char * objectfile_log_name(void *objfile)
+{
+    return objectfile_name(objfile);
+}
+
+
+static void load_relocs_job(void *data, uint64_t idx)
+{
+    struct pending_file *file = ((struct pending_file**) data)[idx];
+    struct symbol_table symtab = {0};
+    struct trace_span span = trace_begin("load relocations");
+
+    int current_log_ctx = log_ctx_new_lazy(objectfile_log_name, file->objfile);
+
+    // Give the front-end the resolved global symbols
+    if (!symbol_table_reserve(&symtab, file->nremap)) {
+        file->status = ENOMEM;
+        log_ctx_pop();
+        trace_end(&span, trace_enabled ? objectfile_name(file->objfile) : NULL);
+        return;
+    }
+
+    for (uint64_t i = 0; i < file->nremap; ++i) {
+        if (file->remap[i] != NULL && !symbol_table_insert(&symtab, i, file->remap[i], NULL)) {
+            file->status = ENOMEM;
+            symbol_table_clear(&symtab);
+            log_ctx_pop();
+            trace_end(&span, trace_enabled ? objectfile_name(file->objfile) : NULL);
+            return;
+        }
+    }
+
+    log_trace("Loading relocations using front-end '%s'", file->reader->name);
+
+    file->status = file->reader->parse_relocs(file->state, &file->sections, &symtab);
+    while (log_ctx > current_log_ctx) {
+        log_warning("Unwinding log context stack");
+        log_ctx_pop();
+    }
+
+    if (file->status != 0) {
+        log_error("Failed to load relocations: %d", file->status);
+    }
+
+    symbol_table_clear(&symtab);
+    log_ctx_pop();
+    trace_end(&span, trace_enabled ? objectfile_name(file->objfile) : NULL);
+}
+
+
+bool linker_load_relocations(struct linkerctx *ctx)
+{
+    bool success = true;
+    struct trace_span span = trace_begin("relocations");
+
+    parallel_for(ctx, ctx->npending, load_relocs_job, ctx->pending);
+
+    for (uint64_t i = 0; i < ctx->npending; ++i) {
+        if (ctx->pending[i]->status != 0) {
+            success = false;
+        }
+        pending_file_free(ctx->pending[i]);
+    }
+
+    free(ctx->pending);
+    ctx->pending = NULL;
+    ctx->npending = 0;
+
+    trace_end(&span, NULL);
+    return success;
+}
+
+
 bool linker_load_objectfile(struct linkerctx *ctx,
                             struct objectfile *objfile,
                             const struct objectfile_reader *reader)
 {
     int status = 0;
     bool success = false;
-    int current_log_ctx = log_ctx_new(objfile->name);
+    struct trace_span span = trace_begin("load object file");
+    int current_log_ctx = log_ctx_new_lazy(objectfile_log_name, objfile);
 
     struct section_table secttab = {0};
     struct symbol_table symtab = {0};
     struct groups groups = {0};
+    struct groups discarded = {0};
+    struct symbol **remap = NULL;
+    uint64_t nremap = 0;
+    void *state = NULL;
 
     uint32_t march = 0;
 
@@ -242,7 +809,7 @@ bool linker_load_objectfile(struct linkerctx *ctx,
     log_trace("Loading object file using front-end '%s'", reader->name);
 
     status = reader->parse_file(ctx, objfile->file_data, objfile->file_size,
-                                &groups, &secttab, &symtab);
+                                &groups, &secttab, &symtab, &state);
     while (log_ctx > current_log_ctx) {
         log_warning("Unwinding log context stack");
         log_ctx_pop();
@@ -253,7 +820,7 @@ bool linker_load_objectfile(struct linkerctx *ctx,
         goto leave;
     }
 
-    // Create new section groups
+    // Create new section groups, groups already loaded from another file are discarded
     groups_for_each_group(groupid, &groups) {
         const char *name = group_name(&groups, groupid);
         bool comdat = groups_is_comdat_group(&groups, groupid);
@@ -261,9 +828,24 @@ bool linker_load_objectfile(struct linkerctx *ctx,
         if (groups_lookup_group(&ctx->groups, name) == 0) {
             log_debug("New section group %s", name);
             groups_create_group(&ctx->groups, name, comdat);
-        } else if (!comdat) {
+            continue;
+        } 
+        
+        if (!comdat) {
             log_error("Multiple definitions for section group %s", name);
         }
+
+        groups_create_group(&discarded, name, comdat);
+    }
+
+    // Map the file's symbol table indexes to resolved global symbols,
+    // so relocations can be fixed up without looking up names
+    nremap = symtab.capacity;
+    if (nremap > 0) {
+        remap = calloc(nremap, sizeof(struct symbol*));
+        if (remap == NULL) {
+            goto leave;
+        }
     }
 
     // Add file's global symbols to the symbol queue
@@ -282,11 +864,12 @@ bool linker_load_objectfile(struct linkerctx *ctx,
 
             if (sect != NULL && sect->group_id != 0) {
                 const char *name = group_name(&groups, sect->group_id);
-                uint64_t realgroup = groups_lookup_group(&ctx->groups, name);
 
-                if (realgroup == 0) {
-                    log_notice("Discarding symbol '%s' defined in seciton group %s", 
+                if (groups_lookup_group(&discarded, name) != 0) {
+                    log_debug("Discarding symbol '%s' defined in section group %s", 
                             symbol_name(sym), name);
+                    // Relocations must refer to the definition that is kept
+                    remap[i] = globals_find_symbol(&ctx->globals, symbol_name(sym));
                     symbol_table_remove(&symtab, i);
                     continue;
                 }
@@ -299,13 +882,6 @@ bool linker_load_objectfile(struct linkerctx *ctx,
             ++defined;
         }
 
-        if (symbol_is_defined(sym) && sym->section != NULL) {
-            if (strncmp(".text._", section_name(sym->section), 7) == 0) {
-                log_notice("Symbol '%s' is defined in section %s", 
-                        symbol_name(sym), section_name(sym->section));
-            }
-        }
-        
         status = globals_insert_symbol(&ctx->globals, sym, &existing);
         if (status != EEXIST && status != 0) {
             goto leave;
@@ -319,6 +895,7 @@ bool linker_load_objectfile(struct linkerctx *ctx,
             }
             symbol_undefine(sym);
         }
+        remap[i] = existing;
 
         if (!symbol_is_defined(existing)) {
             log_trace("Adding undefined symbol '%s' to unresolved queue", symbol_name(existing));
@@ -345,14 +922,15 @@ bool linker_load_objectfile(struct linkerctx *ctx,
 
         if (sect->group_id != 0) {
             const char *name = group_name(&groups, sect->group_id);
-            uint64_t realgroup = groups_lookup_group(&ctx->groups, name);
-            if (realgroup == 0) {
+            if (groups_lookup_group(&discarded, name) != 0) {
                 log_debug("Discarding section %s belonging to section group %s", 
                         section_name(sect), name);
+                section_clear_relocs(sect);
+                section_table_remove(&secttab, i);
                 continue;
             }
 
-            sect->group_id = realgroup;
+            sect->group_id = groups_lookup_group(&ctx->groups, name);
         }
 
         // Make sure that sections have a reference to the object file
@@ -367,7 +945,11 @@ bool linker_load_objectfile(struct linkerctx *ctx,
 
         // Fixup relocations that point to global symbols
         list_for_each_entry(reloc, &sect->relocs, struct reloc, list_entry) {
-            struct symbol *global = globals_find_symbol(&ctx->globals, symbol_name(reloc->symbol));
+            if (reloc->symidx >= nremap) {
+                continue;
+            }
+
+            struct symbol *global = remap[reloc->symidx];
 
             if (global != NULL && global != reloc->symbol) {
                 symbol_put(reloc->symbol);
@@ -375,9 +957,22 @@ bool linker_load_objectfile(struct linkerctx *ctx,
             }
         }
 
-        section_table_remove(&secttab, i);
+        // Keep the section in the file's section table until its relocations are loaded
+        if (reader->parse_relocs == NULL) {
+            section_table_remove(&secttab, i);
+        }
+    }
+
+    if (reader->parse_relocs != NULL) {
+        if (!add_pending_file(ctx, objfile, reader, state, &secttab, remap, nremap)) {
+            goto leave;
+        }
+        memset(&secttab, 0, sizeof(struct section_table));
+        remap = NULL;
+        state = NULL;
     }
 
+    ++ctx->nobjectfiles;
     success = true;
 
 leave:
@@ -390,17 +985,56 @@ leave:
     }
 
     log_ctx_pop();
+    free(remap);
+    if (state != NULL && reader->release_state != NULL) {
+        reader->release_state(state);
+    }
     symbol_table_clear(&symtab);
     section_table_clear(&secttab);
     groups_clear(&groups);
+    groups_clear(&discarded);
+    trace_end(&span, trace_enabled ? objectfile_name(objfile) : NULL);
     return success;
 }
 
 
-bool linker_resolve_globals(struct linkerctx *ctx)
+bool linker_is_section_stripped(const struct linkerctx *ctx, 
+                                enum section_type type, 
+                                bool alloc)
+{
+    switch (ctx->strip) {
+        case STRIP_ALL:
+            if (type == SECTION_METADATA && !alloc) {
+                return true;
+            }
+            // fall through
+
+        case STRIP_DEBUG:
+            return type == SECTION_DEBUG;
+
+        case STRIP_NONE:
+        default:
+            return false;
+    }
+}
+
+
+bool linker_is_group_loaded(const struct linkerctx *ctx, const char *signature)
+{
+    uint64_t group_id = groups_lookup_group(&ctx->groups, signature);
+    return group_id != 0 && groups_is_comdat_group(&ctx->groups, group_id);
+}
+
+
+static bool resolve_globals(struct linkerctx *ctx)
 {
     struct symbol *sym;
 
+    // All input files are read, so the archive index is only used for lookups from now on
+    if (!archives_freeze(&ctx->archives)) {
+        log_debug("Unable to freeze archive index");
+    }
+
     while ((sym = symbols_pop(&ctx->unresolved)) != NULL) {
 
         if (symbol_is_defined(sym) || sym->is_common) {
@@ -425,7 +1059,9 @@ bool linker_resolve_globals(struct linkerctx *ctx)
         // Member provides the symbol, but it is already loaded 
         // We don't try to load it again
         if (archive_is_member_extracted(m)) {
-            log_ctx_new(m->objfile->name);
+            char name[256];
+            archive_member_name(m, name, sizeof(name));
+            log_ctx_push(LOG_CTX(.file = m->archive->name, .name = name));
             log_error("Object file is already loaded but symbol '%s' is still undefined", symbol_name(sym));
             log_ctx_pop();
             symbol_put(sym);
@@ -434,16 +1070,22 @@ bool linker_resolve_globals(struct linkerctx *ctx)
 
         log_trace("Symbol '%s' is provided by archive %s", symbol_name(sym), m->archive->name);
 
+        struct trace_span span = trace_begin("extract member");
+
         struct objectfile *objfile = archive_extract_member(m);
         if (objfile != NULL) {
+            ++ctx->nextracted;
             if (!linker_load_objectfile(ctx, objfile, NULL)) {
                 objectfile_put(objfile);
                 symbol_put(sym);
+                trace_end(&span, trace_enabled ? member_log_name(m) : NULL);
                 return false;
             }
             objectfile_put(objfile);
         }
 
+        trace_end(&span, trace_enabled ? member_log_name(m) : NULL);
+
         if (!symbol_is_defined(sym) && !sym->is_common) {
             log_error("Symbol '%s' was already provided by archive, but is still undefined",
                     symbol_name(sym));
@@ -461,6 +1103,15 @@ bool linker_resolve_globals(struct linkerctx *ctx)
 }
 
 
+bool linker_resolve_globals(struct linkerctx *ctx)
+{
+    struct trace_span span = trace_begin("resolve");
+    bool success = resolve_globals(ctx);
+    trace_end(&span, NULL);
+    return success;
+}
+
+
 bool linker_add_marker_symbol(struct linkerctx *ctx,
                               const char *name,
                               struct section *sect,
@@ -572,13 +1223,186 @@ bool linker_add_got_section(struct linkerctx *ctx)
 }
 
 
+/*
+ * Mark sections depth-first on a single thread.
+ */
+static uint64_t dce_mark_serial(struct sections *wl)
+{
+    struct section *sect;
+    uint64_t nkept = 0;
+
+    // Follow relocations and mark sections as alive
+    while ((sect = sections_pop(wl)) != NULL) {
+        assert(sect->is_alive);
+        ++nkept;
+
+        list_for_each_entry(reloc, &sect->relocs, struct reloc, list_entry) {
+            struct symbol *sym = reloc->symbol;
+            struct section *target = sym->section;
+
+            sym->is_used = true;
+
+            if (target != NULL && !target->is_alive) {
+                target->is_alive = true;
+                sections_push(wl, target);
+            }
+        }
+
+        section_put(sect);
+    }
+
+    return nkept;
+}
+
+
+/*
+ * Links with fewer sections than this are marked on a single thread.
+ */
+#define DCE_PARALLEL_MIN_SECTIONS 4096
+
+
+/*
+ * Number of sections handed over to another worker at a time
+ * when the parallel DCE mark splits its worklist.
+ */
+#define DCE_MARK_BATCH 64
+
+
+/*
+ * Batch of sections to mark in parallel, and their descendants.
+ */
+struct dce_mark_task
+{
+    struct task_group *group;
+    uint64_t *nkept;                            // total number of sections marked (atomically updated)
+    uint64_t n;                                 // number of sections in the batch
+    struct section *sects[DCE_MARK_BATCH];      // sections that are marked, but not yet visited
+};
+
+
+static void dce_mark_parallel_job(void *data);
+
+
+/*
+ * Hand over a batch of sections from the front of the worklist (the
+ * oldest, which tend to have the largest subtrees) to a new task.
+ */
+static void dce_mark_split(struct task_group *group, uint64_t *nkept, struct deque *wl)
+{
+    struct dce_mark_task *task = malloc(sizeof(struct dce_mark_task));
+    if (task == NULL) {
+        // Keep going on this thread instead
+        return;
+    }
+
+    task->group = group;
+    task->nkept = nkept;
+    task->n = 0;
+    while (task->n < DCE_MARK_BATCH) {
+        task->sects[task->n++] = deque_pop_front(wl);
+    }
+
+    task_group_spawn(group, dce_mark_parallel_job, task);
+}
+
+
+/*
+ * Mark sections depth-first with a local worklist. Sections are claimed 
+ * with an atomic exchange on is_alive, so every section is visited by 
+ * exactly one worker. When the worklist grows large, part of it is handed 
+ * over to a new task that idle workers can steal.
+ *
+ * Sections are owned by the linker context for the duration of the mark, 
+ * so no references are taken.
+ */
+static void dce_mark_parallel_job(void *data)
+{
+    struct dce_mark_task *task = data;
+    struct deque wl = DEQUE_INIT;
+    struct section *sect;
+    uint64_t nkept = 0;
+
+    deque_reserve(&wl, 4 * DCE_MARK_BATCH);
+
+    for (uint64_t i = 0; i < task->n; ++i) {
+        deque_push_back(&wl, task->sects[i]);
+    }
+
+    while ((sect = deque_pop_back(&wl)) != NULL) {
+        ++nkept;
+
+        list_for_each_entry(reloc, &sect->relocs, struct reloc, list_entry) {
+            struct symbol *sym = reloc->symbol;
+            struct section *target = sym->section;
+
+            if (!__atomic_load_n(&sym->is_used, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&sym->is_used, true, __ATOMIC_RELAXED);
+            }
+
+            if (target != NULL 
+                    && !__atomic_load_n(&target->is_alive, __ATOMIC_RELAXED)
+                    && !__atomic_exchange_n(&target->is_alive, true, __ATOMIC_RELAXED)) {
+                if (!deque_push_back(&wl, target)) {
+                    log_fatal("Unable to allocate memory");
+                }
+            }
+        }
+
+        if (deque_size(&wl) >= 2 * DCE_MARK_BATCH) {
+            dce_mark_split(task->group, task->nkept, &wl);
+        }
+    }
+
+    __atomic_add_fetch(task->nkept, nkept, __ATOMIC_RELAXED);
+    deque_clear(&wl);
+    free(task);
+}
+
+
+/*
+ * Mark sections on the linker's thread pool, starting from the roots
+ * in the worklist. The set of sections marked is the same as with 
+ * dce_mark_serial(), only the order sections are visited in differs.
+ */
+static uint64_t dce_mark_parallel(struct threadpool *pool, struct sections *wl)
+{
+    struct task_group group;
+    uint64_t nkept = 0;
+    struct section *sect;
+
+    task_group_init(&group, pool);
+
+    while (!sections_empty(wl)) {
+        struct dce_mark_task *task = malloc(sizeof(struct dce_mark_task));
+        if (task == NULL) {
+            log_fatal("Unable to allocate memory");
+            break;
+        }
+
+        task->group = &group;
+        task->nkept = &nkept;
+        task->n = 0;
+        while (task->n < DCE_MARK_BATCH && (sect = sections_pop(wl)) != NULL) {
+            task->sects[task->n++] = sect;
+            section_put(sect);
+        }
+
+        task_group_spawn(&group, dce_mark_parallel_job, task);
+    }
+
+    task_group_wait(&group);
+    return nkept;
+}
+
+
 void linker_dce_mark(struct linkerctx *ctx, const struct symbols *keep)
 {
     struct sections wl = {0};
-    struct section *sect;
+    struct trace_span span = trace_begin("dce mark");
 
     uint64_t nkept = 0;
-    sections_reserve(&wl, sections_size(&ctx->sections));
+    uint64_t nsections = sections_size(&ctx->sections);
+    sections_reserve(&wl, nsections);
 
     // Start with root symbols
     for (uint64_t i = 0; i < keep->q.size; ++i) {
@@ -588,61 +1412,170 @@ void linker_dce_mark(struct linkerctx *ctx, const struct symbols *keep)
             continue;
         }
 
-        if (sym->section != NULL) {
+        sym->is_used = true;
+
+        if (sym->section != NULL && !sym->section->is_alive) {
             sym->section->is_alive = true;
             sections_push(&wl, sym->section);
         }
     }
 
-    // Follow relocations and mark sections as alive
-    while ((sect = sections_pop(&wl)) != NULL) {
-        assert(sect->is_alive);
-        ++nkept;
-
-        list_for_each_entry(reloc, &sect->relocs, struct reloc, list_entry) {
-            const struct symbol *sym = reloc->symbol;
-            struct section *target = sym->section;
-
-            if (target != NULL && !target->is_alive) {
-                target->is_alive = true;
-                sections_push(&wl, target);
-            }
-        }
+    struct threadpool *pool = NULL;
+    if (ctx->threads != 1 && nsections >= DCE_PARALLEL_MIN_SECTIONS) {
+        pool = linker_threadpool(ctx);
+    }
 
-        section_put(sect);
+    if (pool != NULL && threadpool_size(pool) > 1) {
+        nkept = dce_mark_parallel(pool, &wl);
+    } else {
+        nkept = dce_mark_serial(&wl);
     }
 
     sections_clear(&wl);
     log_debug("DCE: Marked %lu sections as alive", nkept);
+    trace_end(&span, NULL);
 }
 
 
-void linker_dce_sweep(struct linkerctx *ctx)
+/*
+ * Number of sections in every shard of the parallel DCE sweep.
+ */
+#define DCE_SWEEP_SHARD_SIZE 1024
+
+
+/*
+ * Range of the sections worklist that is swept by one task.
+ */
+struct dce_sweep_shard
 {
-    uint64_t total_sections = sections_size(&ctx->sections);
-    struct sections keep = {0};
+    uint64_t start;             // position of the first section in the shard
+    uint64_t end;               // position after the last section in the shard
+    uint64_t nkept;             // number of live sections, moved to the start of the shard
+    struct symbols unused;      // symbols whose last reference was held by a removed relocation
+};
 
-    sections_reserve(&keep, total_sections);
 
-    struct section *sect;
-    while ((sect = sections_pop(&ctx->sections)) != NULL) {
+struct dce_sweep
+{
+    struct sections *sections;
+    struct dce_sweep_shard *shards;
+};
+
+
+/*
+ * Partition a shard in place, so that its live sections come first, 
+ * in their original order, followed by the dead sections. Relocations 
+ * of dead sections are removed, and files that sections are kept from 
+ * are flagged.
+ *
+ * Shards are swept concurrently, and nothing that is shared between 
+ * shards is released here: the last references to symbols are left in 
+ * the shard's queue, and dead sections are left in the worklist.
+ */
+static void dce_sweep_shard_job(void *data, uint64_t idx)
+{
+    struct dce_sweep *sweep = data;
+    struct dce_sweep_shard *shard = &sweep->shards[idx];
+    struct deque *q = &sweep->sections->q;
+
+    for (uint64_t pos = shard->start; pos < shard->end; ++pos) {
+        struct section *sect = deque_peek(q, pos);
+
         if (sect->is_alive) {
-            sections_push(&keep, sect);
+            struct objectfile *objfile = sect->objfile;
+            if (objfile != NULL && !__atomic_load_n(&objfile->has_live_sections, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&objfile->has_live_sections, true, __ATOMIC_RELAXED);
+            }
+
+            uint64_t dst = shard->start + shard->nkept++;
+            deque_set(q, pos, deque_peek(q, dst));
+            deque_set(q, dst, sect);
         } else {
             // FIXME: this is necessary because of circular ownership sect -> reloc -> sym -> sect
             // FIXME: in a future version, use arena allocator on linkerctx for sections and symbols
-            section_clear_relocs(sect);
+            section_clear_relocs_deferred(sect, &shard->unused);
         }
-        section_put(sect);
     }
+}
+
+
+void linker_dce_sweep(struct linkerctx *ctx)
+{
+    uint64_t total_sections = sections_size(&ctx->sections);
+    struct trace_span span = trace_begin("dce sweep");
+
+    struct threadpool *pool = NULL;
+    if (ctx->threads != 1 && total_sections >= DCE_PARALLEL_MIN_SECTIONS) {
+        pool = linker_threadpool(ctx);
+    }
+
+    uint64_t shard_size = total_sections;
+    if (pool != NULL && threadpool_size(pool) > 1) {
+        shard_size = DCE_SWEEP_SHARD_SIZE;
+    }
+
+    uint64_t nshards = total_sections > 0 ? (total_sections + shard_size - 1) / shard_size : 0;
+    struct dce_sweep sweep = {
+        .sections = &ctx->sections,
+        .shards = calloc(nshards + 1, sizeof(struct dce_sweep_shard))
+    };
+    if (sweep.shards == NULL) {
+        log_fatal("Unable to allocate memory");
+        trace_end(&span, NULL);
+        return;
+    }
+
+    for (uint64_t i = 0; i < nshards; ++i) {
+        sweep.shards[i].start = i * shard_size;
+        sweep.shards[i].end = i + 1 < nshards ? (i + 1) * shard_size : total_sections;
+    }
+
+    threadpool_parallel_for(pool, nshards, 1, dce_sweep_shard_job, &sweep);
+
+    // Release dead sections, and the content of files that no live 
+    // section is taken from, and move live sections of every shard 
+    // down next to the live sections of the previous shard
+    struct deque *q = &ctx->sections.q;
+    uint64_t nkept = 0;
+    uint64_t nreleased = 0;
+
+    for (uint64_t i = 0; i < nshards; ++i) {
+        struct dce_sweep_shard *shard = &sweep.shards[i];
 
-    assert(sections_empty(&ctx->sections));
+        for (uint64_t pos = shard->start + shard->nkept; pos < shard->end; ++pos) {
+            struct section *sect = deque_peek(q, pos);
+            struct objectfile *objfile = sect->objfile;
 
-    sections_clear(&ctx->sections);
-    ctx->sections = keep;
+            if (objfile != NULL && !objfile->has_live_sections && !objfile->is_released) {
+                objectfile_release_content(objfile);
+                ++nreleased;
+            }
+
+            section_put(sect);
+        }
+
+        for (uint64_t pos = shard->start; pos < shard->start + shard->nkept; ++pos) {
+            deque_set(q, nkept++, deque_peek(q, pos));
+        }
+
+        symbols_clear(&shard->unused);
+    }
+
+    deque_truncate(q, nkept);
+    ctx->sections.nsections = nkept;
+    free(sweep.shards);
 
     log_debug("DCE: Kept %lu sections out of %lu total sections",
-            sections_size(&keep), total_sections);
+            nkept, total_sections);
+    log_debug("DCE: Released content of %lu object files without live sections", nreleased);
+
+    // Drop global symbols that nothing refers to
+    uint64_t total_globals = ctx->globals.nglobals;
+    uint64_t nremoved = globals_remove_unused_symbols(&ctx->globals);
+
+    log_debug("DCE: Removed %lu unused global symbols out of %lu total global symbols",
+            nremoved, total_globals);
+    trace_end(&span, NULL);
 }
 
 
@@ -0,0 +1,234 @@
+#include "logging.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+int log_level = 2;  // initial log level
+_Thread_local int log_ctx = 0;    // initial log context
+_Thread_local log_ctx_t log_ctx_stack[LOG_CTX_MAX] = {0};
+static _Thread_local struct log_buffer *log_captured = NULL;
+
+
+static bool log_buffer_reserve(struct log_buffer *buffer, size_t size)
+{
+    if (buffer->capacity - buffer->size > size) {
+        return true;
+    }
+
+    size_t capacity = buffer->capacity > 0 ? buffer->capacity : 256;
+    while (capacity - buffer->size <= size) {
+        capacity <<= 1;
+    }
+
+    char *data = NULL;
+    if (buffer->fixed) {
+        data = malloc(capacity);
+        if (data != NULL) {
+            memcpy(data, buffer->data, buffer->size);
+        }
+    } else {
+        data = realloc(buffer->data, capacity);
+    }
+
+    if (data == NULL) {
+        return false;
+    }
+
+    buffer->data = data;
+    buffer->capacity = capacity;
+    buffer->fixed = false;
+    return true;
+}
+
+
+static void log_buffer_vprintf(struct log_buffer *buffer, const char *fmt, va_list ap)
+{
+    if (buffer->capacity == 0 && !log_buffer_reserve(buffer, 0)) {
+        return;
+    }
+
+    va_list copy;
+    va_copy(copy, ap);
+    int n = vsnprintf(buffer->data + buffer->size, buffer->capacity - buffer->size, fmt, copy);
+    va_end(copy);
+
+    if (n < 0) {
+        return;
+    }
+
+    if ((size_t) n >= buffer->capacity - buffer->size) {
+        if (!log_buffer_reserve(buffer, n)) {
+            return;
+        }
+        vsnprintf(buffer->data + buffer->size, buffer->capacity - buffer->size, fmt, ap);
+    }
+
+    buffer->size += n;
+}
+
+
+static void log_buffer_printf(struct log_buffer *buffer, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    log_buffer_vprintf(buffer, fmt, ap);
+    va_end(ap);
+}
+
+
+struct log_buffer * log_capture(struct log_buffer *buffer)
+{
+    struct log_buffer *previous = log_captured;
+    log_captured = buffer;
+    return previous;
+}
+
+
+void log_buffer_flush(struct log_buffer *buffer)
+{
+    if (buffer->size > 0) {
+        fwrite(buffer->data, 1, buffer->size, stderr);
+    }
+
+    if (!buffer->fixed) {
+        free(buffer->data);
+    }
+
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->capacity = 0;
+    buffer->fixed = false;
+}
+
+
+/*
+ * Fill in the fields of the current log context that are inherited 
+ * from enclosing contexts. Contexts are stored as they are pushed,
+ * and only resolved when a message is emitted.
+ */
+static void resolve_log_ctx(log_ctx_t *ctx)
+{
+    int idx = log_ctx_safe;
+
+    *ctx = log_ctx_stack[idx];
+
+    while (idx-- > 0 && ctx->file == NULL && ctx->file_name == NULL) {
+        const log_ctx_t *prev = &log_ctx_stack[idx];
+
+        if (ctx->section == NULL) {
+            if (ctx->offset == 0) {
+                if (ctx->lineno == 0) {
+                    ctx->lineno = prev->lineno;
+                }
+                ctx->offset = prev->offset;
+            }
+            ctx->section = prev->section;
+        }
+        ctx->file = prev->file;
+        ctx->file_name = prev->file_name;
+        ctx->file_name_arg = prev->file_name_arg;
+    }
+
+    if (ctx->file == NULL && ctx->file_name != NULL) {
+        ctx->file = ctx->file_name(ctx->file_name_arg);
+    }
+}
+
+
+static const char * level_name(int level)
+{
+    if (level <= LOG_FATAL) {
+        return "fatal";
+    } else if (level == LOG_ERROR) {
+        return "error";
+    } else if (level == LOG_WARNING) {
+        return "warning";
+    } else if (level == LOG_NOTICE) {
+        return "notice";
+    } else if (level == LOG_INFO) {
+        return "info";
+    } else if (level == LOG_DEBUG) {
+        return "debug";
+    }
+    return "trace";
+}
+
+
+/*
+ * Messages are formatted into a buffer and written with a single 
+ * write, so that messages from different threads are not mixed up.
+ * If messages are captured, they are appended to the capture buffer.
+ */
+void log_message_va(int level, const char *fmt, va_list ap)
+{
+    if (level > log_level) {
+        return;
+    }
+
+    char scratch[512];
+    struct log_buffer line = {
+        .data = scratch,
+        .size = 0,
+        .capacity = sizeof(scratch),
+        .fixed = true
+    };
+    struct log_buffer *buffer = log_captured != NULL ? log_captured : &line;
+
+    log_ctx_t resolved;
+    const log_ctx_t *ctx = &resolved;
+    resolve_log_ctx(&resolved);
+
+    if (ctx->file != NULL && ctx->file[0] != '\0') {
+        log_buffer_printf(buffer, "[%s", ctx->file);
+
+        if (ctx->section != NULL) {
+            log_buffer_printf(buffer, ":%s", ctx->section);
+        }
+
+        if (ctx->offset > 0) {
+            log_buffer_printf(buffer, "+0x%zx", ctx->offset);
+        }
+
+        if (ctx->lineno > 0) {
+            log_buffer_printf(buffer, ":%u", ctx->lineno);
+        } 
+
+        if (ctx->name != NULL) {
+            log_buffer_printf(buffer, "(%s)", ctx->name);
+        }
+
+        log_buffer_printf(buffer, "] ");
+
+    } else if (ctx->section != NULL && ctx->section[0] != '\0') {
+        log_buffer_printf(buffer, "[%s", ctx->section);
+        if (ctx->name != NULL && ctx->name[0] != '\0') {
+            log_buffer_printf(buffer, "(%s)", ctx->name);
+        }
+        log_buffer_printf(buffer, "] ");
+
+    } else {
+        if (ctx->name != NULL) {
+            log_buffer_printf(buffer, "(%s) ", ctx->name);
+        }
+    }
+
+    log_buffer_printf(buffer, "%s: ", level_name(level));
+    log_buffer_vprintf(buffer, fmt, ap);
+    log_buffer_printf(buffer, "\n");
+
+    if (buffer == &line) {
+        log_buffer_flush(&line);
+    }
+}
+
+
+void log_emit(int level, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    log_message_va(level, fmt, ap);
+    va_end(ap);
+}
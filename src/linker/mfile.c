@@ -2,6 +2,8 @@
 #include "mfile.h"
 #include "logging.h"
 #include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -10,6 +12,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <assert.h>
+#include <pthread.h>
 
 
 extern char * strdup(const char *s);
@@ -18,6 +21,29 @@ extern char * strdup(const char *s);
 extern int ftruncate(int fd, off_t length);
 
 
+/*
+ * Files that are currently memory-mapped, for residency reports.
+ */
+static struct list_head mapped_files = LIST_HEAD_INIT(mapped_files);
+static pthread_mutex_t mapped_files_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static void add_mapped_file(struct mfile *file)
+{
+    pthread_mutex_lock(&mapped_files_lock);
+    list_insert_tail(&mapped_files, &file->list_node);
+    pthread_mutex_unlock(&mapped_files_lock);
+}
+
+
+static void remove_mapped_file(struct mfile *file)
+{
+    pthread_mutex_lock(&mapped_files_lock);
+    list_remove(&file->list_node);
+    pthread_mutex_unlock(&mapped_files_lock);
+}
+
+
 
 int mfile_open_read(struct mfile **file, const char *pathname)
 {
@@ -93,7 +119,9 @@ int mfile_open_read(struct mfile **file, const char *pathname)
     f->refcnt = 1;
     f->fd = fd;
     f->size = s.st_size;
+    f->mtime = s.st_mtime;
     f->data = p;
+    add_mapped_file(f);
 
     *file = f;
 
@@ -179,7 +207,9 @@ int mfile_open_write(struct mfile **file, const char *pathname, size_t size)
     f->refcnt = 1;
     f->fd = fd;
     f->size = size;
+    f->mtime = 0;
     f->data = p;
+    add_mapped_file(f);
 
     *file = f;
 
@@ -206,6 +236,8 @@ void mfile_put(struct mfile *file)
 
         log_ctx_new(file->name);
 
+        remove_mapped_file(file);
+
         if (file->fd >= 0) {
             // If memory came from a file, unmap and close file
             munmap((void*) file->data, file->size);
@@ -220,3 +252,117 @@ void mfile_put(struct mfile *file)
         log_ctx_pop();
     }
 }
+
+
+void mfile_release(struct mfile *file, const void *data, size_t size)
+{
+    uintptr_t pagesize = sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t) data + pagesize - 1) & ~(pagesize - 1);
+    uintptr_t end = ((uintptr_t) data + size) & ~(pagesize - 1);
+
+    assert((const char*) data >= (const char*) file->data);
+    assert((const char*) data + size <= (const char*) file->data + file->size);
+    (void) file;
+
+    if (start < end && madvise((void*) start, end - start, MADV_DONTNEED) != 0) {
+        log_debug("Unable to release memory of file %s: %s", file->name, strerror(errno));
+    }
+}
+
+
+/*
+ * Sum the resident set size of the mappings of open files, from the 
+ * Rss field of every mapping in /proc/self/smaps. Must be called with 
+ * mapped_files_lock held. Returns false if smaps can not be read.
+ */
+static bool smaps_resident(uint64_t *resident)
+{
+    FILE *fp = fopen("/proc/self/smaps", "r");
+    if (fp == NULL) {
+        return false;
+    }
+
+    char line[4096 + 256];
+    bool counting = false;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        unsigned long start, end;
+        unsigned long long kb;
+
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            // Mapping header, check if the mapping belongs to an open file
+            counting = false;
+            list_for_each_entry(file, &mapped_files, struct mfile, list_node) {
+                uintptr_t data = (uintptr_t) file->data;
+                if (file->size > 0 && start >= data && start < data + file->size) {
+                    counting = true;
+                    break;
+                }
+            }
+        } else if (counting && sscanf(line, "Rss: %llu kB", &kb) == 1) {
+            *resident += kb * 1024;
+        }
+    }
+
+    fclose(fp);
+    return true;
+}
+
+
+void mfile_residency(uint64_t *mapped, uint64_t *resident, uint64_t *cached)
+{
+    long pagesize = sysconf(_SC_PAGESIZE);
+    unsigned char *vec = NULL;
+    size_t veclen = 0;
+
+    *mapped = 0;
+    *resident = 0;
+    *cached = 0;
+
+    pthread_mutex_lock(&mapped_files_lock);
+
+    list_for_each_entry(file, &mapped_files, struct mfile, list_node) {
+        if (file->size == 0) {
+            continue;
+        }
+
+        *mapped += file->size;
+
+        size_t npages = (file->size + pagesize - 1) / pagesize;
+        if (npages > veclen) {
+            unsigned char *v = realloc(vec, npages);
+            if (v == NULL) {
+                continue;
+            }
+            vec = v;
+            veclen = npages;
+        }
+
+        // mincore() tells whether pages are in the page cache, 
+        // not whether this process has them mapped
+        if (mincore((void*) file->data, file->size, vec) != 0) {
+            continue;
+        }
+
+        for (size_t i = 0; i < npages; ++i) {
+            if (vec[i] & 1) {
+                *cached += pagesize;
+            }
+        }
+    }
+
+    if (!smaps_resident(resident)) {
+        *resident = *cached;
+    }
+
+    pthread_mutex_unlock(&mapped_files_lock);
+
+    free(vec);
+
+    if (*cached > *mapped) {
+        *cached = *mapped;
+    }
+    if (*resident > *mapped) {
+        *resident = *mapped;
+    }
+}
@@ -10,6 +10,8 @@
 #include "section.h"
 #include "sections.h"
 #include "objectfile_reader.h"
+#include "archive.h"
+#include <stdio.h>
 
 
 // strdup is a POSIX function
@@ -31,6 +33,13 @@ void objectfile_put(struct objectfile *objfile)
     assert(objfile->refcnt > 0);
     
     if (--(objfile->refcnt) == 0) {
+        if (objfile->archive != NULL) {
+            struct archive_member *member = archive_get_member(objfile->archive, objfile->member);
+            if (member != NULL && member->objfile == objfile) {
+                member->objfile = NULL;
+            }
+            archive_put(objfile->archive);
+        }
         mfile_put(objfile->file);
         free(objfile->name);
         free(objfile);
@@ -70,11 +79,96 @@ struct objectfile * objectfile_alloc(struct mfile *file,
         return NULL;
     }
 
+    objfile->archive = NULL;
+    objfile->member = 0;
     objfile->file = mfile_get(file);
     objfile->refcnt = 1;
     objfile->file_data = file_data;
     objfile->file_size = file_size;
+    objfile->has_live_sections = false;
+    objfile->is_released = false;
     return objfile;
 }
 
 
+
+
+struct objectfile * objectfile_alloc_member(struct archive *archive,
+                                            size_t member,
+                                            const uint8_t *file_data,
+                                            size_t file_size)
+{
+    struct mfile *file = archive->file;
+
+    if (file_data < ((const uint8_t*) file->data) || 
+            (file_data + file_size) > (((const uint8_t*) file->data) + file->size)) {
+        log_error("Object file data content is outside valid range");
+        return NULL;
+    }
+
+    struct objectfile *objfile = malloc(sizeof(struct objectfile));
+    if (objfile == NULL) {
+        return NULL;
+    }
+
+    objfile->name = NULL;
+    objfile->archive = archive_get(archive);
+    objfile->member = member;
+    objfile->file = mfile_get(file);
+    objfile->refcnt = 1;
+    objfile->file_data = file_data;
+    objfile->file_size = file_size;
+    objfile->has_live_sections = false;
+    objfile->is_released = false;
+    return objfile;
+}
+
+
+void objectfile_release_content(struct objectfile *objfile)
+{
+    if (!objfile->is_released) {
+        mfile_release(objfile->file, objfile->file_data, objfile->file_size);
+        objfile->is_released = true;
+    }
+}
+
+
+const char * objectfile_name(struct objectfile *objfile)
+{
+    char *name = __atomic_load_n(&objfile->name, __ATOMIC_ACQUIRE);
+    if (name != NULL) {
+        return name;
+    }
+
+    const struct archive *ar = objfile->archive;
+    const struct archive_member *member = archive_get_member(ar, objfile->member);
+    size_t len = member != NULL ? archive_member_name(member, NULL, 0) : 0;
+
+    if (len > 0) {
+        name = malloc(strlen(ar->name) + len + 3);
+        if (name != NULL) {
+            size_t n = sprintf(name, "%s(", ar->name);
+            archive_member_name(member, name + n, len + 1);
+            strcpy(name + n + len, ")");
+        }
+    } else {
+        name = malloc(strlen(ar->name) + 24);
+        if (name != NULL) {
+            sprintf(name, "%s:%zu", ar->name, objfile->member);
+        }
+    }
+
+    if (name == NULL) {
+        return ar->name;
+    }
+
+    // Another thread may have formatted the name in the meantime
+    char *expected = NULL;
+    if (!__atomic_compare_exchange_n(&objfile->name, &expected, name, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(name);
+        return expected;
+    }
+
+    return name;
+}
@@ -0,0 +1,206 @@
+#include "linker.h"
+#include "globals.h"
+#include "symbol.h"
+#include "section.h"
+#include "objectfile.h"
+#include "archives.h"
+#include "strpool.h"
+#include "groups.h"
+#include "tablestats.h"
+#include "mfile.h"
+#include "utils/memacct.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+
+/*
+ * Entry in the section symbol report.
+ */
+struct section_symbol
+{
+    const char *file;
+    const char *section;
+    const char *symbol;
+    bool alive;
+};
+
+
+static int compare_section_symbols(const void *a, const void *b)
+{
+    const struct section_symbol *x = a;
+    const struct section_symbol *y = b;
+
+    int diff = strcmp(x->file, y->file);
+    if (diff == 0) {
+        diff = strcmp(x->section, y->section);
+    }
+    if (diff == 0) {
+        diff = strcmp(x->symbol, y->symbol);
+    }
+    return diff;
+}
+
+
+/*
+ * Check if a section is a function or data section,
+ * i.e., a section of its own for a single symbol.
+ */
+static bool is_symbol_section(const char *name)
+{
+    static const char *prefixes[] = {".text.", ".data.", ".rodata.", ".bss."};
+
+    for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); ++i) {
+        size_t len = strlen(prefixes[i]);
+        if (strncmp(name, prefixes[i], len) == 0 && name[len] != '\0') {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool linker_report_section_symbols(struct linkerctx *ctx, FILE *fp)
+{
+    struct section_symbol *entries = NULL;
+    uint64_t nentries = 0;
+
+    if (ctx->globals.nglobals > 0) {
+        entries = malloc(sizeof(struct section_symbol) * ctx->globals.nglobals);
+        if (entries == NULL) {
+            return false;
+        }
+    }
+
+    for (uint64_t i = 0; i < ctx->globals.capacity; ++i) {
+        const struct global *global = &ctx->globals.table[i];
+        const struct symbol *sym = global->symbol;
+
+        if (global->hash == 0 || sym == NULL || sym->section == NULL || !symbol_is_defined(sym)) {
+            continue;
+        }
+
+        const char *name = section_name(sym->section);
+        if (!is_symbol_section(name)) {
+            continue;
+        }
+
+        struct objectfile *objfile = sym->section->objfile;
+
+        entries[nentries++] = (struct section_symbol) {
+            .file = objfile != NULL ? objectfile_name(objfile) : "",
+            .section = name,
+            .symbol = symbol_name(sym),
+            .alive = sym->section->is_alive
+        };
+    }
+
+    if (nentries > 0) {
+        qsort(entries, nentries, sizeof(struct section_symbol), compare_section_symbols);
+    }
+
+    fprintf(fp, "Symbols defined in sections of their own\n");
+    fprintf(fp, "%-32s %-40s %-5s %s\n", "File", "Section", "Kept", "Symbol");
+
+    for (uint64_t i = 0; i < nentries; ++i) {
+        const struct section_symbol *entry = &entries[i];
+        fprintf(fp, "%-32s %-40s %-5s %s\n", 
+                entry->file, entry->section, entry->alive ? "yes" : "no", entry->symbol);
+    }
+
+    fprintf(fp, "\n%llu symbols in %llu global symbols\n", 
+            (unsigned long long) nentries, (unsigned long long) ctx->globals.nglobals);
+
+    free(entries);
+    return true;
+}
+
+
+static void print_table_stats(FILE *fp, const char *name, const struct table_stats *stats)
+{
+    uint64_t lookups = stats->hits + stats->misses;
+
+    fprintf(fp, "%-10s %10llu %10llu %6.2f %8llu %7llu %8.2f %12llu %12llu %8.2f\n",
+            name,
+            (unsigned long long) stats->capacity,
+            (unsigned long long) stats->entries,
+            stats->capacity > 0 ? (double) stats->entries / stats->capacity : 0.0,
+            (unsigned long long) stats->rehashes,
+            (unsigned long long) stats->max_dfi,
+            stats->entries > 0 ? (double) stats->total_dfi / stats->entries : 0.0,
+            (unsigned long long) stats->hits,
+            (unsigned long long) stats->misses,
+            lookups > 0 ? (double) stats->probes / lookups : 0.0);
+}
+
+
+void linker_print_stats(const struct linkerctx *ctx, FILE *fp)
+{
+    struct table_stats stats;
+
+    fprintf(fp, "Hash table statistics\n");
+    fprintf(fp, "%-10s %10s %10s %6s %8s %7s %8s %12s %12s %8s\n",
+            "Table", "Capacity", "Entries", "Load", "Rehashes", 
+            "MaxDFI", "MeanDFI", "Hits", "Misses", "Probes");
+
+    globals_table_stats(&ctx->globals, &stats);
+    print_table_stats(fp, "globals", &stats);
+
+    archives_table_stats(&ctx->archives, &stats);
+    print_table_stats(fp, "archives", &stats);
+
+    strpool_table_stats(ctx->strings, &stats);
+    print_table_stats(fp, "strings", &stats);
+
+    strpool_table_stats(&ctx->groups.signatures, &stats);
+    print_table_stats(fp, "groups", &stats);
+}
+
+
+void linker_print_memory_report(FILE *fp, const char *phase)
+{
+    struct memacct_stats total = {0};
+    struct memacct_stats stats;
+
+    fprintf(fp, "Memory usage after %s\n", phase);
+    fprintf(fp, "%-10s %12s %12s %12s %12s\n",
+            "Subsystem", "Live kB", "Peak kB", "Live objs", "Peak objs");
+
+    for (int tag = 0; tag < MEMACCT_NTAGS; ++tag) {
+        memacct_get_stats(tag, &stats);
+        fprintf(fp, "%-10s %12llu %12llu %12llu %12llu\n",
+                memacct_tag_name(tag),
+                (unsigned long long) (stats.live_bytes + 1023) / 1024,
+                (unsigned long long) (stats.peak_bytes + 1023) / 1024,
+                (unsigned long long) stats.live_objects,
+                (unsigned long long) stats.peak_objects);
+        total.live_bytes += stats.live_bytes;
+        total.live_objects += stats.live_objects;
+    }
+
+    fprintf(fp, "%-10s %12llu %12s %12llu %12s\n", "total",
+            (unsigned long long) (total.live_bytes + 1023) / 1024, "",
+            (unsigned long long) total.live_objects, "");
+
+    uint64_t mapped, resident, cached;
+    mfile_residency(&mapped, &resident, &cached);
+    fprintf(fp, "Input files: %llu kB mapped, %llu kB resident, %llu kB in page cache\n",
+            (unsigned long long) (mapped + 1023) / 1024,
+            (unsigned long long) (resident + 1023) / 1024,
+            (unsigned long long) (cached + 1023) / 1024);
+
+    // Resident set of the whole process, including the heap
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm != NULL) {
+        unsigned long long size, rss;
+        if (fscanf(statm, "%llu %llu", &size, &rss) == 2) {
+            fprintf(fp, "Process: %llu kB resident\n", rss * sysconf(_SC_PAGESIZE) / 1024);
+        }
+        fclose(statm);
+    }
+}
@@ -2,8 +2,10 @@
 #include "section.h"
 #include "objectfile.h"
 #include "symbol.h"
+#include "symbols.h"
 #include "strpool.h"
 #include "linker.h"
+#include "utils/memacct.h"
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
@@ -62,7 +64,7 @@ struct section * section_alloc(const struct linkerctx *ctx,
         log_warning("Section has unknown name. Defaulting to '%s'", name);
     }
 
-    struct section *sect = malloc(sizeof(struct section));
+    struct section *sect = memacct_malloc(MEMACCT_SECTIONS, sizeof(struct section));
     if (sect == NULL) {
         return NULL;
     }
@@ -89,7 +91,7 @@ struct section * section_alloc(const struct linkerctx *ctx,
 
 struct section * section_clone(const struct section *original, const char *name)
 {
-    struct section *sect = malloc(sizeof(struct section));
+    struct section *sect = memacct_malloc(MEMACCT_SECTIONS, sizeof(struct section));
     if (sect == NULL) {
         return NULL;
     }
@@ -120,7 +122,7 @@ struct section * section_clone(const struct section *original, const char *name)
     list_head_init(&sect->relocs);
     list_for_each_entry(reloc, &original->relocs, struct reloc, list_entry) {
         section_add_reloc(sect, reloc->offset, reloc->symbol, 
-                          reloc->type, reloc->addend);
+                          reloc->symidx, reloc->type, reloc->addend);
     }
 
     return sect;
@@ -145,7 +147,7 @@ void section_put(struct section *sect)
         section_clear_relocs(sect);
 
         if (sect->symbols != NULL) {
-            free(sect->symbols);
+            memacct_free(MEMACCT_SECTIONS, sect->symbols);
         }
 
         if (sect->objfile != NULL) {
@@ -153,7 +155,7 @@ void section_put(struct section *sect)
         }
 
         strpool_put(sect->strings);
-        free(sect);
+        memacct_free(MEMACCT_SECTIONS, sect);
     }
 }
 
@@ -163,17 +165,18 @@ void section_remove_reloc(struct reloc *reloc)
     list_remove(&reloc->list_entry);
     --(reloc->section->nrelocs);
     symbol_put(reloc->symbol);
-    free(reloc);
+    memacct_free(MEMACCT_RELOCS, reloc);
 }
 
 
 struct reloc * section_add_reloc(struct section *section,
                                  uint64_t offset,
                                  struct symbol *symbol,
+                                 uint32_t symidx,
                                  uint32_t type,
                                  int64_t addend)
 {
-    struct reloc *reloc = malloc(sizeof(struct reloc));
+    struct reloc *reloc = memacct_malloc(MEMACCT_RELOCS, sizeof(struct reloc));
     if (reloc == NULL) {
         return NULL;
     }
@@ -182,6 +185,7 @@ struct reloc * section_add_reloc(struct section *section,
     reloc->offset = offset;
     reloc->symbol = symbol_get(symbol);
     reloc->type = type;
+    reloc->symidx = symidx;
     reloc->addend = addend;
 
     list_insert_tail(&section->relocs, &reloc->list_entry);
@@ -199,6 +203,28 @@ void section_clear_relocs(struct section *sect)
 }
 
 
+void section_clear_relocs_deferred(struct section *sect, struct symbols *deferred)
+{
+    while (!list_empty(&sect->relocs)) {
+        struct reloc *reloc = list_first_entry(&sect->relocs, struct reloc, list_entry);
+
+        list_remove(&reloc->list_entry);
+        --(sect->nrelocs);
+
+        if (!symbol_put_unless_last(reloc->symbol)) {
+            // Hand the last reference over to the deferred queue
+            if (symbols_push(deferred, reloc->symbol)) {
+                symbol_put(reloc->symbol);
+            } else {
+                log_fatal("Unable to allocate memory");
+            }
+        }
+
+        memacct_free(MEMACCT_RELOCS, reloc);
+    }
+}
+
+
 bool section_add_symbol_reference(struct section *sect, struct symbol *sym)
 {
     size_t low = 0;
@@ -221,7 +247,7 @@ bool section_add_symbol_reference(struct section *sect, struct symbol *sym)
         }
     }
 
-    struct symbol **syms = realloc(sect->symbols, sizeof(struct symbol*) * (sect->nsymbols + 1));
+    struct symbol **syms = memacct_realloc(MEMACCT_SECTIONS, sect->symbols, sizeof(struct symbol*) * (sect->nsymbols + 1));
     if (syms == NULL) {
         return false;
     }
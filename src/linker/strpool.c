@@ -2,6 +2,7 @@
 #include "strpool.h"
 #include "utils/align.h"
 #include "utils/hash.h"
+#include "utils/memacct.h"
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -48,7 +49,7 @@ bool strissuffix(const char *suffix, size_t suffixlen, const char *s, size_t len
 
 struct strpool * strpool_alloc(void)
 {
-    struct strpool *pool = malloc(sizeof(struct strpool));
+    struct strpool *pool = memacct_malloc(MEMACCT_STRINGS, sizeof(struct strpool));
     if (pool == NULL) {
         return NULL;
     }
@@ -61,6 +62,7 @@ struct strpool * strpool_alloc(void)
     pool->capacity = 0;
     pool->index = NULL;
     pool->rehash_threshold = 0;
+    memset(&pool->stats, 0, sizeof(struct table_stats));
 
     strpool_extend(pool, 256);
     strpool_rehash(pool, 64);
@@ -71,8 +73,8 @@ struct strpool * strpool_alloc(void)
 struct strpool * strpool_get(struct strpool *pool)
 {
     assert(pool != NULL);
-    assert(pool->refcnt != 0);
-    pool->refcnt++;
+    assert(__atomic_load_n(&pool->refcnt, __ATOMIC_RELAXED) != 0);
+    __atomic_add_fetch(&pool->refcnt, 1, __ATOMIC_RELAXED);
     return pool;
 }
 
@@ -80,11 +82,11 @@ struct strpool * strpool_get(struct strpool *pool)
 void strpool_put(struct strpool *pool)
 {
     assert(pool != NULL);
-    assert(pool->refcnt != 0);
+    assert(__atomic_load_n(&pool->refcnt, __ATOMIC_RELAXED) != 0);
 
-    if (--(pool->refcnt) == 0) {
+    if (__atomic_sub_fetch(&pool->refcnt, 1, __ATOMIC_ACQ_REL) == 0) {
         strpool_clear(pool);
-        free(pool);
+        memacct_free(MEMACCT_STRINGS, pool);
     }
 }
 
@@ -107,7 +109,7 @@ bool strpool_rehash(struct strpool *pool, uint64_t capacity)
         return false;
     }
 
-    struct strintern *index = (struct strintern*) calloc(capacity, sizeof(struct strintern));
+    struct strintern *index = (struct strintern*) memacct_calloc(MEMACCT_STRINGS, capacity, sizeof(struct strintern));
     if (index == NULL) {
         return false;
     }
@@ -150,10 +152,11 @@ bool strpool_rehash(struct strpool *pool, uint64_t capacity)
         }
     }
 
-    free(pool->index);
+    memacct_free(MEMACCT_STRINGS, pool->index);
     pool->index = index;
     pool->capacity = capacity;
     pool->rehash_threshold = STRING_POOL_REHASH_THRESHOLD(capacity);
+    pool->stats.rehashes++;
 
     if (pool->strings == NULL) {
         if (strpool_extend(pool, 256)) {
@@ -179,10 +182,10 @@ bool strpool_extend(struct strpool *pool, size_t length)
 
     uint64_t size = pool->size > 0 ? pool->size * 2 : 256;
     if (size < pool->offset + length) {
-        size = align_pow2(pool->offset + length);
+        size = align_roundup(pool->offset + length);
     }
 
-    char *strings = (char*) realloc(pool->strings, size);
+    char *strings = (char*) memacct_realloc(MEMACCT_STRINGS, pool->strings, size);
     if (strings == NULL) {
         return false;
     }
@@ -198,10 +201,26 @@ bool strpool_extend(struct strpool *pool, size_t length)
 }
 
 
+void strpool_table_stats(const struct strpool *pool, struct table_stats *stats)
+{
+    *stats = pool->stats;
+    stats->capacity = pool->capacity;
+    stats->entries = 0;
+    stats->max_dfi = 0;
+    stats->total_dfi = 0;
+
+    for (uint64_t i = 0; i < pool->capacity; ++i) {
+        if (pool->index[i].hash != 0) {
+            table_stats_entry(stats, pool->index[i].dfi);
+        }
+    }
+}
+
+
 void strpool_clear(struct strpool *pool)
 {
     if (pool->index != NULL) {
-        free(pool->index);
+        memacct_free(MEMACCT_STRINGS, pool->index);
     }
     pool->index = NULL;
     pool->capacity = 0;
@@ -209,7 +228,7 @@ void strpool_clear(struct strpool *pool)
     pool->rehash_threshold = 0;
 
     if (pool->strings != NULL) {
-        free(pool->strings);
+        memacct_free(MEMACCT_STRINGS, pool->strings);
     }
     pool->strings = NULL;
     pool->size = 0;
@@ -335,8 +354,8 @@ uint64_t strpool_pack(struct strpool *pool, const char *strtab, uint64_t size)
     }
 
     uint64_t count = 0;
-    const char **sorted = malloc(sizeof(const char*) * size);
-    size_t *lengths = malloc(sizeof(size_t) * size);
+    const char **sorted = memacct_malloc(MEMACCT_STRINGS, sizeof(const char*) * size);
+    size_t *lengths = memacct_malloc(MEMACCT_STRINGS, sizeof(size_t) * size);
 
     // Extract strings and their lengths from the string table
     uint64_t pos = 0;
@@ -376,7 +395,7 @@ uint64_t strpool_pack(struct strpool *pool, const char *strtab, uint64_t size)
         }
     }
     
-    free(lengths);
-    free(sorted);
+    memacct_free(MEMACCT_STRINGS, lengths);
+    memacct_free(MEMACCT_STRINGS, sorted);
     return count;
 }
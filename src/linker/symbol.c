@@ -3,6 +3,7 @@
 #include "logging.h"
 #include "objectfile.h"
 #include "utils/hash.h"
+#include "utils/memacct.h"
 #include "linker.h"
 #include <stdlib.h>
 #include <string.h>
@@ -16,8 +17,9 @@
 struct symbol * symbol_get(struct symbol *sym)
 {
     assert(sym != NULL);
-    assert(sym->refcnt > 0);
-    ++(sym->refcnt);
+    assert(__atomic_load_n(&sym->refcnt, __ATOMIC_RELAXED) > 0);
+    // Relocations for different files are loaded concurrently, and may refer to the same symbol
+    __atomic_add_fetch(&sym->refcnt, 1, __ATOMIC_RELAXED);
     return sym;
 }
 
@@ -25,22 +27,48 @@ struct symbol * symbol_get(struct symbol *sym)
 void symbol_put(struct symbol *sym)
 {
     assert(sym != NULL);
-    assert(sym->refcnt > 0);
+    assert(__atomic_load_n(&sym->refcnt, __ATOMIC_RELAXED) > 0);
 
-    if (--(sym->refcnt) == 0) {
+    if (__atomic_sub_fetch(&sym->refcnt, 1, __ATOMIC_ACQ_REL) == 0) {
         if (symbol_is_defined(sym)) {
             symbol_undefine(sym);
         }
         strpool_put(sym->strings);
-        free(sym);
+        memacct_free(MEMACCT_SYMBOLS, sym);
     }
 }
 
 
+bool symbol_put_unless_last(struct symbol *sym)
+{
+    assert(sym != NULL);
+    int refcnt = __atomic_load_n(&sym->refcnt, __ATOMIC_RELAXED);
+
+    while (refcnt > 1) {
+        if (__atomic_compare_exchange_n(&sym->refcnt, &refcnt, refcnt - 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+
+    assert(refcnt == 1);
+    return false;
+}
+
+
 struct symbol * symbol_alloc(const struct linkerctx *ctx,
                              const char *name, 
                              enum symbol_type type, 
                              enum symbol_binding binding)
+{
+    return symbol_alloc_strings(ctx->strings, name, type, binding);
+}
+
+
+struct symbol * symbol_alloc_strings(struct strpool *strings,
+                                     const char *name, 
+                                     enum symbol_type type, 
+                                     enum symbol_binding binding)
 {
     switch (type) {
         case SYMBOL_NOTYPE:
@@ -55,7 +83,7 @@ struct symbol * symbol_alloc(const struct linkerctx *ctx,
             return NULL;
     }
 
-    struct symbol *sym = malloc(sizeof(struct symbol));
+    struct symbol *sym = memacct_malloc(MEMACCT_SYMBOLS, sizeof(struct symbol));
     if (sym == NULL) {
         return NULL;
     }
@@ -66,8 +94,8 @@ struct symbol * symbol_alloc(const struct linkerctx *ctx,
         sym->hash = 1;
     }
     
-    sym->strings = strpool_get(ctx->strings);
-    sym->name_id = strpool_intern(ctx->strings, name);
+    sym->strings = strpool_get(strings);
+    sym->name_id = strpool_intern(strings, name);
 
     sym->binding = binding;
     sym->type = type;
@@ -76,6 +104,7 @@ struct symbol * symbol_alloc(const struct linkerctx *ctx,
     sym->size = 0;
     sym->is_absolute = false;
     sym->is_common = false;
+    sym->is_used = false;
     sym->section = NULL;
     sym->offset = 0;
     sym->visibility = SYMBOL_PUBLIC;
@@ -121,7 +150,7 @@ bool symbol_define(struct symbol *sym, struct section *section,
                     symbol_name(sym), offset, sym->offset);
         } else {
             log_error("Redefinition for symbol '%s'", symbol_name(sym));
-            const char *filename = sym->section->objfile != NULL ? sym->section->objfile->name : NULL;
+            const char *filename = sym->section->objfile != NULL ? objectfile_name(sym->section->objfile) : NULL;
             log_ctx_push(LOG_CTX(.file = filename, .section = section_name(sym->section)));
             log_error("Symbol '%s' was previously defined here", symbol_name(sym));
             log_ctx_pop();
@@ -239,7 +268,7 @@ bool symbol_merge(struct symbol *existing, const struct symbol *incoming)
 
             } else {
                 log_error("Multiple definitions for symbol '%s'", symbol_name(existing));
-                const char *filename = existing->section->objfile != NULL ? existing->section->objfile->name : NULL;
+                const char *filename = existing->section->objfile != NULL ? objectfile_name(existing->section->objfile) : NULL;
                 log_ctx_push(LOG_CTX(.file = filename, .section = section_name(existing->section)));
                 log_error("Symbol '%s' was previously defined here", symbol_name(existing));
                 log_ctx_pop();
@@ -259,23 +288,3 @@ bool symbol_merge(struct symbol *existing, const struct symbol *incoming)
 
     return true;
 }
-
-
-//bool symbol_is_alive(const struct symbol *sym)
-//{
-//    // Symbols that are kept, exported or referenced by a relocation
-//    // are always considered "alive"
-//    if (sym->is_used) {
-//        return true;
-//    }
-//
-//    if (!symbol_is_defined(sym)) {
-//        return false; // disregard undefined symbols
-//    }
-//
-//    if (sym->is_absolute || sym->section == NULL) {
-//        return false; // disregard absolute symbols that aren't used
-//    }
-//
-//    return !sym->section->discarded;
-//}
@@ -0,0 +1,172 @@
+#include "timereport.h"
+#include "linker.h"
+#include "sections.h"
+#include "section.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/resource.h>
+
+
+static uint64_t clock_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    if (clock_gettime(clock, &ts) != 0) {
+        return 0;
+    }
+
+    return ((uint64_t) ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static void take_sample(struct time_sample *sample)
+{
+    struct rusage usage;
+
+    sample->wall_ns = clock_ns(CLOCK_MONOTONIC);
+    sample->cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    sample->max_rss_kb = 0;
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        sample->max_rss_kb = usage.ru_maxrss;
+    }
+}
+
+
+bool time_report_begin(struct time_report *report, const char *name)
+{
+    if (report->nphases == report->capacity) {
+        size_t capacity = report->capacity > 0 ? report->capacity * 2 : 8;
+        struct time_phase *phases = realloc(report->phases, sizeof(struct time_phase) * capacity);
+        if (phases == NULL) {
+            return false;
+        }
+        report->phases = phases;
+        report->capacity = capacity;
+    }
+
+    struct time_phase *phase = &report->phases[report->nphases++];
+    *phase = (struct time_phase) {
+        .name = name
+    };
+
+    take_sample(&phase->start);
+    phase->end = phase->start;
+    return true;
+}
+
+
+void time_report_end(struct time_report *report, const struct linkerctx *ctx)
+{
+    if (report->nphases == 0) {
+        return;
+    }
+
+    struct time_phase *phase = &report->phases[report->nphases - 1];
+    take_sample(&phase->end);
+
+    phase->files = ctx->nobjectfiles;
+    phase->extracted = ctx->nextracted;
+    phase->sections = sections_size(&ctx->sections);
+    phase->symbols = ctx->globals.nglobals;
+    phase->relocations = 0;
+
+    for (uint64_t i = 0; i < phase->sections; ++i) {
+        const struct section *sect = sections_at(&ctx->sections, i);
+        phase->relocations += sect->nrelocs;
+    }
+}
+
+
+static void print_text(const struct time_report *report, FILE *fp)
+{
+    struct time_phase total = { .name = "total" };
+
+    fprintf(fp, "%-16s %10s %10s %10s %8s %8s %10s %10s %12s\n",
+            "Phase", "Wall (ms)", "CPU (ms)", "RSS (kB)", "Files", "Members", "Sections", "Symbols", "Relocations");
+
+    for (size_t i = 0; i < report->nphases; ++i) {
+        const struct time_phase *phase = &report->phases[i];
+
+        fprintf(fp, "%-16s %10.3f %10.3f %+10lld %8llu %8llu %10llu %10llu %12llu\n",
+                phase->name,
+                (phase->end.wall_ns - phase->start.wall_ns) / 1e6,
+                (phase->end.cpu_ns - phase->start.cpu_ns) / 1e6,
+                (long long) (phase->end.max_rss_kb - phase->start.max_rss_kb),
+                (unsigned long long) phase->files,
+                (unsigned long long) phase->extracted,
+                (unsigned long long) phase->sections,
+                (unsigned long long) phase->symbols,
+                (unsigned long long) phase->relocations);
+
+        if (i == 0) {
+            total.start = phase->start;
+        }
+        total.end = phase->end;
+    }
+
+    fprintf(fp, "%-16s %10.3f %10.3f %10llu\n", total.name,
+            (total.end.wall_ns - total.start.wall_ns) / 1e6,
+            (total.end.cpu_ns - total.start.cpu_ns) / 1e6,
+            (unsigned long long) total.end.max_rss_kb);
+}
+
+
+static void print_json(const struct time_report *report, FILE *fp)
+{
+    fprintf(fp, "{\"phases\": [");
+
+    for (size_t i = 0; i < report->nphases; ++i) {
+        const struct time_phase *phase = &report->phases[i];
+
+        fprintf(fp, "%s\n  {\"name\": \"%s\", \"wall_ns\": %llu, \"cpu_ns\": %llu, "
+                    "\"max_rss_delta_kb\": %lld, \"files\": %llu, \"extracted\": %llu, "
+                    "\"sections\": %llu, \"symbols\": %llu, \"relocations\": %llu}",
+                i > 0 ? "," : "",
+                phase->name,
+                (unsigned long long) (phase->end.wall_ns - phase->start.wall_ns),
+                (unsigned long long) (phase->end.cpu_ns - phase->start.cpu_ns),
+                (long long) (phase->end.max_rss_kb - phase->start.max_rss_kb),
+                (unsigned long long) phase->files,
+                (unsigned long long) phase->extracted,
+                (unsigned long long) phase->sections,
+                (unsigned long long) phase->symbols,
+                (unsigned long long) phase->relocations);
+    }
+
+    const struct time_phase *first = report->nphases > 0 ? &report->phases[0] : NULL;
+    const struct time_phase *last = report->nphases > 0 ? &report->phases[report->nphases - 1] : NULL;
+
+    fprintf(fp, "\n], \"total\": {\"wall_ns\": %llu, \"cpu_ns\": %llu, \"max_rss_kb\": %llu}}\n",
+            first != NULL ? (unsigned long long) (last->end.wall_ns - first->start.wall_ns) : 0ULL,
+            first != NULL ? (unsigned long long) (last->end.cpu_ns - first->start.cpu_ns) : 0ULL,
+            last != NULL ? (unsigned long long) last->end.max_rss_kb : 0ULL);
+}
+
+
+void time_report_print(const struct time_report *report, FILE *fp, enum time_report_format format)
+{
+    switch (format) {
+        case TIME_REPORT_JSON:
+            print_json(report, fp);
+            break;
+
+        case TIME_REPORT_TEXT:
+        default:
+            print_text(report, fp);
+            break;
+    }
+}
+
+
+void time_report_clear(struct time_report *report)
+{
+    free(report->phases);
+    report->phases = NULL;
+    report->nphases = 0;
+    report->capacity = 0;
+}
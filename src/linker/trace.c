@@ -0,0 +1,201 @@
+#define _GNU_SOURCE
+#include "trace.h"
+#include "logging.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+
+/*
+ * Recorded span.
+ */
+struct trace_event
+{
+    const char *name;
+    char *detail;
+    uint64_t start;
+    uint64_t end;
+    long tid;
+};
+
+
+bool trace_enabled = false;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static char *trace_pathname = NULL;
+static uint64_t trace_epoch = 0;
+static struct trace_event *trace_events = NULL;
+static size_t trace_nevents = 0;
+static size_t trace_capacity = 0;
+
+
+uint64_t trace_clock(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return 1;
+    }
+
+    return ((uint64_t) ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+
+static long thread_id(void)
+{
+    static _Thread_local long tid = 0;
+
+    if (tid == 0) {
+        tid = syscall(SYS_gettid);
+    }
+
+    return tid;
+}
+
+
+bool trace_open(const char *pathname)
+{
+    char *copy = strdup(pathname);
+    if (copy == NULL) {
+        return false;
+    }
+
+    // Fail early if the file can not be written
+    FILE *fp = fopen(pathname, "w");
+    if (fp == NULL) {
+        log_error("Could not open trace file '%s': %s", pathname, strerror(errno));
+        free(copy);
+        return false;
+    }
+    fclose(fp);
+
+    free(trace_pathname);
+    trace_pathname = copy;
+    trace_epoch = trace_clock();
+    trace_enabled = true;
+    return true;
+}
+
+
+void trace_record(const struct trace_span *span, const char *detail)
+{
+    struct trace_event event = {
+        .name = span->name,
+        .detail = NULL,
+        .start = span->start,
+        .end = trace_clock(),
+        .tid = thread_id()
+    };
+
+    if (detail != NULL) {
+        event.detail = strdup(detail);
+    }
+
+    pthread_mutex_lock(&trace_lock);
+
+    if (trace_nevents == trace_capacity) {
+        size_t capacity = trace_capacity > 0 ? trace_capacity * 2 : 256;
+        struct trace_event *events = realloc(trace_events, sizeof(struct trace_event) * capacity);
+        if (events == NULL) {
+            pthread_mutex_unlock(&trace_lock);
+            free(event.detail);
+            return;
+        }
+        trace_events = events;
+        trace_capacity = capacity;
+    }
+
+    trace_events[trace_nevents++] = event;
+
+    pthread_mutex_unlock(&trace_lock);
+}
+
+
+static void write_string(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+
+    for (; *s != '\0'; ++s) {
+        unsigned char c = *s;
+
+        if (c == '"' || c == '\\') {
+            fputc('\\', fp);
+            fputc(c, fp);
+        } else if (c < 0x20) {
+            fprintf(fp, "\\u%04x", c);
+        } else {
+            fputc(c, fp);
+        }
+    }
+
+    fputc('"', fp);
+}
+
+
+static bool write_trace(FILE *fp)
+{
+    long pid = getpid();
+
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    fprintf(fp, "\n  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %ld, \"tid\": %ld, "
+                "\"args\": {\"name\": \"bfld\"}}", pid, pid);
+
+    for (size_t i = 0; i < trace_nevents; ++i) {
+        const struct trace_event *event = &trace_events[i];
+        uint64_t start = event->start > trace_epoch ? event->start - trace_epoch : 0;
+
+        fprintf(fp, ",\n  {\"name\": ");
+        write_string(fp, event->name);
+        fprintf(fp, ", \"cat\": \"bfld\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %ld, \"tid\": %ld",
+                start / 1e3, (event->end - event->start) / 1e3, pid, event->tid);
+
+        if (event->detail != NULL) {
+            fprintf(fp, ", \"args\": {\"detail\": ");
+            write_string(fp, event->detail);
+            fprintf(fp, "}");
+        }
+
+        fprintf(fp, "}");
+    }
+
+    fprintf(fp, "\n]}\n");
+    return !ferror(fp);
+}
+
+
+void trace_close(void)
+{
+    if (!trace_enabled) {
+        return;
+    }
+
+    trace_enabled = false;
+
+    FILE *fp = fopen(trace_pathname, "w");
+    if (fp == NULL || !write_trace(fp)) {
+        log_error("Could not write trace file '%s': %s", trace_pathname, strerror(errno));
+    }
+
+    if (fp != NULL) {
+        fclose(fp);
+    }
+
+    for (size_t i = 0; i < trace_nevents; ++i) {
+        free(trace_events[i].detail);
+    }
+    free(trace_events);
+    trace_events = NULL;
+    trace_nevents = 0;
+    trace_capacity = 0;
+
+    free(trace_pathname);
+    trace_pathname = NULL;
+}
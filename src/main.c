@@ -14,6 +14,8 @@
 #include <archive.h>
 #include <objectfile_reader.h>
 #include <archive_reader.h>
+#include <timereport.h>
+#include <trace.h>
 #include "commandline.h"
 #include <utils/list.h>
 
@@ -99,10 +101,16 @@
 //}
 
 
-static bool load_file(struct linkerctx *ctx, const char *pathname)
+/*
+ * Open an input file and load it if it is an object file.
+ * Archives are not read right away, but returned through archive
+ * so that all archives can be read together.
+ */
+static bool load_file(struct linkerctx *ctx, const char *pathname, struct archive **archive)
 {
     struct mfile *file = NULL;
 
+    *archive = NULL;
     log_ctx_new(pathname);
 
     int status = mfile_open_read(&file, pathname);
@@ -117,11 +125,10 @@ static bool load_file(struct linkerctx *ctx, const char *pathname)
         struct archive *ar = archive_alloc(file, file->name, file->data, file->size);
 
         if (ar != NULL) {
-            bool success = linker_read_archive(ctx, ar, reader);
-            archive_put(ar);
+            *archive = ar;
             mfile_put(file);
             log_ctx_pop();
-            return success;
+            return true;
         }
     }
 
@@ -235,6 +242,32 @@ static bool load_file(struct linkerctx *ctx, const char *pathname)
 //}
 
 
+/*
+ * Start timing a link phase, if time reports are enabled.
+ */
+static void phase_begin(const struct bfld_options *opts, struct time_report *report, const char *name)
+{
+    if (opts->time_report) {
+        time_report_begin(report, name);
+    }
+}
+
+
+/*
+ * Stop timing a link phase and report memory usage, if enabled.
+ */
+static void phase_end(const struct bfld_options *opts, struct time_report *report, const struct linkerctx *ctx, const char *name)
+{
+    if (opts->time_report) {
+        time_report_end(report, ctx);
+    }
+
+    if (opts->memory_report) {
+        linker_print_memory_report(stderr, name);
+    }
+}
+
+
 int main(int argc, char **argv)
 {
     struct bfld_options opts = {0};
@@ -247,11 +280,24 @@ int main(int argc, char **argv)
         exit(-start);
     }
 
+    struct time_report report = {0};
+
+    if (opts.trace != NULL) {
+        if (!trace_open(opts.trace)) {
+            exit(1);
+        }
+        atexit(trace_close);
+    }
+
     struct linkerctx *ctx = linker_alloc(opts.output, TARGET_X86_64);
     if (ctx == NULL) {
         exit(2);
     }
 
+    ctx->index_cache = opts.index_cache;
+    ctx->strip = opts.strip;
+    ctx->threads = opts.threads;
+
     if (start >= argc) {
         log_error("No input files");
         linker_put(ctx);
@@ -261,21 +307,66 @@ int main(int argc, char **argv)
     linker_add_got_section(ctx);
     linker_add_crt_markers(ctx);
 
-    for (int i = start; i < argc; ++i) {
-        bool success = load_file(ctx, argv[i]);
-        if (!success) {
-            linker_put(ctx);
-            exit(1);
+    struct archive **archives = calloc(argc - start, sizeof(struct archive*));
+    size_t narchives = 0;
+    if (archives == NULL) {
+        linker_put(ctx);
+        exit(2);
+    }
+
+    phase_begin(&opts, &report, "load");
+
+    bool success = true;
+    for (int i = start; i < argc && success; ++i) {
+        struct archive *ar = NULL;
+        success = load_file(ctx, argv[i], &ar);
+        if (ar != NULL) {
+            archives[narchives++] = ar;
         }
     } 
 
+    phase_end(&opts, &report, ctx, "load");
+
+    if (success) {
+        phase_begin(&opts, &report, "archives");
+        success = linker_read_archives(ctx, archives, narchives);
+        phase_end(&opts, &report, ctx, "archives");
+    }
+
+    for (size_t i = 0; i < narchives; ++i) {
+        archive_put(archives[i]);
+    }
+    free(archives);
+
+    if (!success) {
+        time_report_clear(&report);
+        linker_put(ctx);
+        exit(1);
+    }
+
     if (sections_empty(&ctx->sections)) {
         log_fatal("No input files");
+        time_report_clear(&report);
         linker_put(ctx);
         exit(1);
     }
 
-    if (!linker_resolve_globals(ctx)) {
+    phase_begin(&opts, &report, "resolve");
+    success = linker_resolve_globals(ctx);
+    phase_end(&opts, &report, ctx, "resolve");
+
+    if (!success) {
+        time_report_clear(&report);
+        linker_put(ctx);
+        exit(2);
+    }
+
+    phase_begin(&opts, &report, "relocations");
+    success = linker_load_relocations(ctx);
+    phase_end(&opts, &report, ctx, "relocations");
+
+    if (!success) {
+        time_report_clear(&report);
         linker_put(ctx);
         exit(2);
     }
@@ -283,6 +374,7 @@ int main(int argc, char **argv)
     struct symbol *entry = linker_find_symbol(ctx, opts.entry);
     if (entry == NULL) {
         log_fatal("Undefined reference to symbol '%s'", opts.entry);
+        time_report_clear(&report);
         linker_put(ctx);
         exit(2);
     }
@@ -291,12 +383,34 @@ int main(int argc, char **argv)
         struct symbols keep = {0};
         symbols_push(&keep, entry);
 
+        phase_begin(&opts, &report, "dce-mark");
         linker_dce_mark(ctx, &keep);
+        phase_end(&opts, &report, ctx, "dce-mark");
+
+        // Report before the sweep, which removes unused global symbols
+        if (opts.report_section_symbols) {
+            linker_report_section_symbols(ctx, stdout);
+        }
+
+        phase_begin(&opts, &report, "dce-sweep");
         linker_dce_sweep(ctx);
+        phase_end(&opts, &report, ctx, "dce-sweep");
 
         symbols_clear(&keep);
+
+    } else if (opts.report_section_symbols) {
+        linker_report_section_symbols(ctx, stdout);
+    }
+
+    if (opts.time_report) {
+        time_report_print(&report, stdout, opts.time_report_format);
+    }
+
+    if (opts.stats) {
+        linker_print_stats(ctx, stderr);
     }
 
+    time_report_clear(&report);
     linker_put(ctx);
     exit(0);
 }
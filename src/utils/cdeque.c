@@ -0,0 +1,149 @@
+#include "cdeque.h"
+#include "align.h"
+#include "memacct.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/*
+ * Circular buffer of a concurrent deque.
+ *
+ * The implementation follows "Correct and Efficient Work-Stealing for
+ * Weak Memory Models" (Lê et al., PPoPP 2013), except that the fences
+ * are folded into the loads and stores of top and bottom (release store
+ * to publish an entry, sequentially consistent accesses where the owner
+ * and poppers at the front race), which TSan understands.
+ */
+struct cdeque_buffer
+{
+    struct cdeque_buffer *prev;     // buffer that this buffer replaced
+    int64_t capacity;               // number of entries (power of two)
+    void *q[];
+};
+
+
+void cdeque_clear(struct cdeque *d)
+{
+    struct cdeque_buffer *b = d->buffer;
+
+    while (b != NULL) {
+        struct cdeque_buffer *prev = b->prev;
+        memacct_free(MEMACCT_DEQUE, b);
+        b = prev;
+    }
+
+    cdeque_init(d);
+}
+
+
+static struct cdeque_buffer * grow(struct cdeque *d, uint64_t capacity, int64_t top, int64_t bottom)
+{
+    struct cdeque_buffer *old = d->buffer;
+
+    if (capacity < 8) {
+        capacity = 8;
+    }
+    capacity = align_roundup(capacity);
+
+    struct cdeque_buffer *b = memacct_malloc(MEMACCT_DEQUE, sizeof(struct cdeque_buffer) + sizeof(void*) * capacity);
+    if (b == NULL) {
+        return NULL;
+    }
+
+    b->prev = old;
+    b->capacity = capacity;
+
+    if (old != NULL) {
+        for (int64_t i = top; i < bottom; ++i) {
+            void *entry = __atomic_load_n(&old->q[i & (old->capacity - 1)], __ATOMIC_RELAXED);
+            __atomic_store_n(&b->q[i & (b->capacity - 1)], entry, __ATOMIC_RELAXED);
+        }
+    }
+
+    __atomic_store_n(&d->buffer, b, __ATOMIC_RELEASE);
+    return b;
+}
+
+
+bool cdeque_reserve(struct cdeque *d, uint64_t capacity)
+{
+    struct cdeque_buffer *b = __atomic_load_n(&d->buffer, __ATOMIC_RELAXED);
+
+    if (b != NULL && (uint64_t) b->capacity >= capacity) {
+        return true;
+    }
+
+    int64_t bottom = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    return grow(d, capacity, top, bottom) != NULL;
+}
+
+
+bool cdeque_push_back(struct cdeque *d, void *entry)
+{
+    int64_t bottom = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    struct cdeque_buffer *b = __atomic_load_n(&d->buffer, __ATOMIC_RELAXED);
+
+    if (b == NULL || bottom - top > b->capacity - 1) {
+        b = grow(d, b != NULL ? b->capacity * 2 : 8, top, bottom);
+        if (b == NULL) {
+            return false;
+        }
+    }
+
+    __atomic_store_n(&b->q[bottom & (b->capacity - 1)], entry, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->bottom, bottom + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+
+void * cdeque_pop_back(struct cdeque *d)
+{
+    int64_t bottom = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    struct cdeque_buffer *b = __atomic_load_n(&d->buffer, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->bottom, bottom, __ATOMIC_SEQ_CST);
+    int64_t top = __atomic_load_n(&d->top, __ATOMIC_SEQ_CST);
+
+    if (top > bottom) {
+        // Deque was empty
+        __atomic_store_n(&d->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    void *entry = __atomic_load_n(&b->q[bottom & (b->capacity - 1)], __ATOMIC_RELAXED);
+
+    if (top == bottom) {
+        // Last entry, race against poppers at the front for it
+        if (!__atomic_compare_exchange_n(&d->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            entry = NULL;
+        }
+        __atomic_store_n(&d->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+
+    return entry;
+}
+
+
+void * cdeque_pop_front(struct cdeque *d)
+{
+    while (true) {
+        int64_t top = __atomic_load_n(&d->top, __ATOMIC_SEQ_CST);
+        int64_t bottom = __atomic_load_n(&d->bottom, __ATOMIC_SEQ_CST);
+
+        if (top >= bottom) {
+            return NULL;
+        }
+
+        struct cdeque_buffer *b = __atomic_load_n(&d->buffer, __ATOMIC_ACQUIRE);
+        void *entry = __atomic_load_n(&b->q[top & (b->capacity - 1)], __ATOMIC_RELAXED);
+
+        if (__atomic_compare_exchange_n(&d->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            return entry;
+        }
+
+        // Lost the race to another thread, which made progress, so try again
+    }
+}
@@ -1,5 +1,6 @@
 #include "deque.h"
 #include "align.h"
+#include "memacct.h"
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdbool.h>
@@ -24,7 +25,7 @@ bool deque_reserve(struct deque *d, uint64_t capacity)
         return false;
     }
 
-    void **q = realloc(d->q, sizeof(void*) * capacity);
+    void **q = memacct_realloc(MEMACCT_DEQUE, d->q, sizeof(void*) * capacity);
     if (q == NULL) {
         return false;
     }
@@ -50,7 +51,7 @@ bool deque_reserve(struct deque *d, uint64_t capacity)
 void deque_clear(struct deque *d)
 {
     if (d->q != NULL) {
-        free(d->q);
+        memacct_free(MEMACCT_DEQUE, d->q);
         d->q = NULL;
     }
     deque_init(d);
@@ -0,0 +1,147 @@
+#include "memacct.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#if BFLD_MEMACCT
+#include <malloc.h>
+#endif
+
+
+/*
+ * Counters for a tag. Counters are updated atomically as allocations
+ * are made from many threads, and kept on cache lines of their own.
+ */
+struct memacct_counters
+{
+    uint64_t live_bytes;
+    uint64_t peak_bytes;
+    uint64_t live_objects;
+    uint64_t peak_objects;
+    uint64_t allocs;
+} __attribute__((aligned(64)));
+
+
+static struct memacct_counters counters[MEMACCT_NTAGS];
+
+
+static const char *tag_names[MEMACCT_NTAGS] = {
+    [MEMACCT_OTHER] = "other",
+    [MEMACCT_SECTIONS] = "sections",
+    [MEMACCT_RELOCS] = "relocs",
+    [MEMACCT_SYMBOLS] = "symbols",
+    [MEMACCT_STRINGS] = "strings",
+    [MEMACCT_ARCHIVES] = "archives",
+    [MEMACCT_GLOBALS] = "globals",
+    [MEMACCT_DEQUE] = "deque",
+    [MEMACCT_TABLE] = "table",
+};
+
+
+#if BFLD_MEMACCT
+
+static void update_peak(uint64_t *peak, uint64_t value)
+{
+    uint64_t current = __atomic_load_n(peak, __ATOMIC_RELAXED);
+
+    while (value > current) {
+        if (__atomic_compare_exchange_n(peak, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+}
+
+
+static void account(enum memacct_tag tag, int64_t bytes, int64_t objects)
+{
+    struct memacct_counters *c = &counters[tag];
+
+    uint64_t live = __atomic_add_fetch(&c->live_bytes, bytes, __ATOMIC_RELAXED);
+    if (bytes > 0) {
+        update_peak(&c->peak_bytes, live);
+    }
+
+    if (objects != 0) {
+        live = __atomic_add_fetch(&c->live_objects, objects, __ATOMIC_RELAXED);
+        if (objects > 0) {
+            __atomic_add_fetch(&c->allocs, 1, __ATOMIC_RELAXED);
+            update_peak(&c->peak_objects, live);
+        }
+    }
+}
+
+
+void * memacct_malloc(enum memacct_tag tag, size_t size)
+{
+    void *ptr = malloc(size);
+
+    if (ptr != NULL) {
+        account(tag, malloc_usable_size(ptr), 1);
+    }
+
+    return ptr;
+}
+
+
+void * memacct_calloc(enum memacct_tag tag, size_t nmemb, size_t size)
+{
+    void *ptr = calloc(nmemb, size);
+
+    if (ptr != NULL) {
+        account(tag, malloc_usable_size(ptr), 1);
+    }
+
+    return ptr;
+}
+
+
+void * memacct_realloc(enum memacct_tag tag, void *ptr, size_t size)
+{
+    size_t old_size = ptr != NULL ? malloc_usable_size(ptr) : 0;
+
+    void *new_ptr = realloc(ptr, size);
+    if (new_ptr == NULL) {
+        // The old allocation is left as it is, unless size is 0
+        if (size == 0 && ptr != NULL) {
+            account(tag, -(int64_t) old_size, -1);
+        }
+        return NULL;
+    }
+
+    account(tag, (int64_t) malloc_usable_size(new_ptr) - (int64_t) old_size, ptr == NULL);
+    return new_ptr;
+}
+
+
+void memacct_free(enum memacct_tag tag, void *ptr)
+{
+    if (ptr != NULL) {
+        account(tag, -(int64_t) malloc_usable_size(ptr), -1);
+        free(ptr);
+    }
+}
+
+#endif
+
+
+void memacct_get_stats(enum memacct_tag tag, struct memacct_stats *stats)
+{
+    const struct memacct_counters *c = &counters[tag];
+
+    stats->live_bytes = __atomic_load_n(&c->live_bytes, __ATOMIC_RELAXED);
+    stats->peak_bytes = __atomic_load_n(&c->peak_bytes, __ATOMIC_RELAXED);
+    stats->live_objects = __atomic_load_n(&c->live_objects, __ATOMIC_RELAXED);
+    stats->peak_objects = __atomic_load_n(&c->peak_objects, __ATOMIC_RELAXED);
+    stats->allocs = __atomic_load_n(&c->allocs, __ATOMIC_RELAXED);
+}
+
+
+const char * memacct_tag_name(enum memacct_tag tag)
+{
+    if (tag < MEMACCT_NTAGS) {
+        return tag_names[tag];
+    }
+
+    return "unknown";
+}
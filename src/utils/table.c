@@ -1,5 +1,6 @@
 #include "table.h"
 #include "align.h"
+#include "memacct.h"
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -17,7 +18,7 @@ bool table_reserve(struct table *tbl, uint64_t capacity)
         return false;
     }
 
-    void **table = realloc(tbl->table, sizeof(void*) * capacity);
+    void **table = memacct_realloc(MEMACCT_TABLE, tbl->table, sizeof(void*) * capacity);
     if (table == NULL) {
         return false;
     }
@@ -32,7 +33,7 @@ bool table_reserve(struct table *tbl, uint64_t capacity)
 void table_clear(struct table *tbl)
 {
     if (tbl->table != NULL) {
-        free(tbl->table);
+        memacct_free(MEMACCT_TABLE, tbl->table);
     }
     table_init(tbl);
 }
@@ -0,0 +1,520 @@
+#include "threadpool.h"
+#include "cdeque.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <assert.h>
+
+
+/*
+ * Upper limit on the number of workers.
+ */
+#define THREADPOOL_MAX_THREADS 1024
+
+
+/*
+ * Initial number of entries in a worker's deque.
+ */
+#define DEQUE_INITIAL_SIZE 256
+
+
+/*
+ * Number of times an idle worker looks for work
+ * before it goes to sleep.
+ */
+#define IDLE_SPINS 64
+
+
+/*
+ * Task that is queued on a worker's deque. Tasks are allocated
+ * when they are spawned and freed when they have run.
+ */
+struct task
+{
+    void (*run)(struct task *task);
+    struct task_group *group;
+};
+
+
+/*
+ * Task spawned with task_group_spawn().
+ */
+struct func_task
+{
+    struct task task;
+    void (*func)(void *data);
+    void *data;
+};
+
+
+/*
+ * Chunk of indexes for threadpool_parallel_for().
+ */
+struct range_task
+{
+    struct task task;
+    void (*func)(void *data, uint64_t idx);
+    void *data;
+    uint64_t begin;
+    uint64_t end;
+    uint64_t grain;
+};
+
+
+struct worker
+{
+    struct cdeque deque;    // tasks spawned by the worker
+    struct threadpool *pool;
+    unsigned index;
+    uint64_t seed;          // state for picking victims to steal from
+    pthread_t thread;
+} __attribute__((aligned(64)));
+
+
+struct threadpool
+{
+    unsigned nworkers;
+    unsigned started;       // number of background threads started
+    struct worker *workers;
+    pthread_t owner;        // thread that allocated the pool (worker 0)
+    uint64_t queued;        // upper bound on the number of tasks in deques
+    unsigned sleepers;      // number of threads waiting on wake
+    bool shutdown;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+};
+
+
+/*
+ * Worker that the current thread is running, if any.
+ */
+static _Thread_local struct worker *current_worker = NULL;
+
+
+/*
+ * Get the worker of the calling thread. Threads that are
+ * not workers of the pool act as worker 0.
+ */
+static struct worker * worker_self(const struct threadpool *pool)
+{
+    if (current_worker != NULL && current_worker->pool == pool) {
+        return current_worker;
+    }
+
+    assert(pthread_equal(pthread_self(), pool->owner));
+    return &pool->workers[0];
+}
+
+
+/*
+ * Wake up sleeping threads, after spawning a task (one thread)
+ * or after a task group completed (all threads).
+ */
+static void wake_sleepers(struct threadpool *pool, bool all)
+{
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        if (all) {
+            pthread_cond_broadcast(&pool->wake);
+        } else {
+            pthread_cond_signal(&pool->wake);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+
+/*
+ * Sleep until there are queued tasks, the pool is shut down, or
+ * the group (if not NULL) has completed.
+ *
+ * The sleeper count is incremented before checking the conditions,
+ * and wakers update the conditions before checking the sleeper count,
+ * so either the sleeper sees the update or the waker sees the sleeper.
+ */
+static void sleep_until_work(struct threadpool *pool, struct task_group *group)
+{
+    pthread_mutex_lock(&pool->lock);
+    __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+
+    while (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0
+            && !__atomic_load_n(&pool->shutdown, __ATOMIC_SEQ_CST)
+            && (group == NULL || __atomic_load_n(&group->pending, __ATOMIC_SEQ_CST) > 0)) {
+        pthread_cond_wait(&pool->wake, &pool->lock);
+    }
+
+    __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+
+/*
+ * Take a task from the worker's own deque, or steal one from
+ * another worker. Returns NULL if no task was found.
+ */
+static struct task * find_task(struct threadpool *pool, struct worker *self)
+{
+    struct task *task = cdeque_pop_back(&self->deque);
+    if (task != NULL) {
+        __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+        return task;
+    }
+
+    unsigned n = pool->nworkers;
+    if (n <= 1) {
+        return NULL;
+    }
+
+    // xorshift to pick the first victim
+    self->seed ^= self->seed << 13;
+    self->seed ^= self->seed >> 7;
+    self->seed ^= self->seed << 17;
+    unsigned start = self->seed % n;
+
+    for (unsigned i = 0; i < n; ++i) {
+        struct worker *victim = &pool->workers[(start + i) % n];
+        if (victim == self) {
+            continue;
+        }
+
+        task = cdeque_pop_front(&victim->deque);
+        if (task != NULL) {
+            __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+            return task;
+        }
+    }
+
+    return NULL;
+}
+
+
+static void run_task(struct threadpool *pool, struct task *task)
+{
+    struct task_group *group = task->group;
+
+    task->run(task);
+    free(task);
+
+    // The group may be released by its waiter as soon as
+    // pending reaches zero, so it must not be touched after
+    if (__atomic_sub_fetch(&group->pending, 1, __ATOMIC_SEQ_CST) == 0) {
+        wake_sleepers(pool, true);
+    }
+}
+
+
+static void * worker_main(void *arg)
+{
+    struct worker *self = arg;
+    struct threadpool *pool = self->pool;
+    unsigned idle = 0;
+
+    current_worker = self;
+
+    while (!__atomic_load_n(&pool->shutdown, __ATOMIC_ACQUIRE)) {
+        struct task *task = find_task(pool, self);
+
+        if (task != NULL) {
+            run_task(pool, task);
+            idle = 0;
+        } else if (++idle < IDLE_SPINS) {
+            sched_yield();
+        } else {
+            sleep_until_work(pool, NULL);
+            idle = 0;
+        }
+    }
+
+    current_worker = NULL;
+    return NULL;
+}
+
+
+/*
+ * Queue a task on the calling thread's deque.
+ * Returns false if the deque could not grow.
+ */
+static bool spawn_task(struct task_group *group, struct task *task)
+{
+    struct threadpool *pool = group->pool;
+    struct worker *self = worker_self(pool);
+
+    task->group = group;
+    __atomic_add_fetch(&group->pending, 1, __ATOMIC_SEQ_CST);
+
+    // Count the task before it is visible, so that queued is never
+    // less than the number of tasks in deques
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+
+    if (!cdeque_push_back(&self->deque, task)) {
+        __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+        __atomic_sub_fetch(&group->pending, 1, __ATOMIC_SEQ_CST);
+        return false;
+    }
+
+    wake_sleepers(pool, false);
+    return true;
+}
+
+
+unsigned threadpool_default_threads(void)
+{
+    const char *env = getenv("BFLD_THREADS");
+
+    if (env != NULL && *env != '\0') {
+        char *end = NULL;
+        unsigned long n = strtoul(env, &end, 10);
+        if (*end == '\0' && n > 0) {
+            return n < THREADPOOL_MAX_THREADS ? n : THREADPOOL_MAX_THREADS;
+        }
+    }
+
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpus < 1) {
+        return 1;
+    }
+    return ncpus < THREADPOOL_MAX_THREADS ? ncpus : THREADPOOL_MAX_THREADS;
+}
+
+
+struct threadpool * threadpool_alloc(unsigned nthreads)
+{
+    if (nthreads == 0) {
+        nthreads = threadpool_default_threads();
+    }
+    if (nthreads > THREADPOOL_MAX_THREADS) {
+        nthreads = THREADPOOL_MAX_THREADS;
+    }
+
+    struct threadpool *pool = malloc(sizeof(struct threadpool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    pool->workers = aligned_alloc(64, sizeof(struct worker) * nthreads);
+    if (pool->workers == NULL) {
+        free(pool);
+        return NULL;
+    }
+
+    memset(pool->workers, 0, sizeof(struct worker) * nthreads);
+    pool->nworkers = nthreads;
+    pool->started = 0;
+    pool->owner = pthread_self();
+    pool->queued = 0;
+    pool->sleepers = 0;
+    pool->shutdown = false;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    for (unsigned i = 0; i < nthreads; ++i) {
+        struct worker *w = &pool->workers[i];
+        w->pool = pool;
+        w->index = i;
+        w->seed = 0x9e3779b97f4a7c15ULL * (i + 1);
+
+        cdeque_init(&w->deque);
+        if (!cdeque_reserve(&w->deque, DEQUE_INITIAL_SIZE)) {
+            for (unsigned j = 0; j < i; ++j) {
+                cdeque_clear(&pool->workers[j].deque);
+            }
+            pthread_cond_destroy(&pool->wake);
+            pthread_mutex_destroy(&pool->lock);
+            free(pool->workers);
+            free(pool);
+            return NULL;
+        }
+    }
+
+    // If threads can not be created, the remaining workers
+    // simply have empty deques and never run anything
+    for (unsigned i = 1; i < nthreads; ++i) {
+        struct worker *w = &pool->workers[i];
+        if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+            break;
+        }
+        ++pool->started;
+    }
+
+    return pool;
+}
+
+
+void threadpool_free(struct threadpool *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+
+    assert(pool->queued == 0);
+
+    __atomic_store_n(&pool->shutdown, true, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 1; i <= pool->started; ++i) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    for (unsigned i = 0; i < pool->nworkers; ++i) {
+        cdeque_clear(&pool->workers[i].deque);
+    }
+
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+
+unsigned threadpool_size(const struct threadpool *pool)
+{
+    return pool != NULL ? pool->nworkers : 1;
+}
+
+
+unsigned threadpool_worker_index(const struct threadpool *pool)
+{
+    if (pool == NULL) {
+        return 0;
+    }
+    return worker_self(pool)->index;
+}
+
+
+static void run_func_task(struct task *task)
+{
+    struct func_task *ft = (struct func_task*) task;
+    ft->func(ft->data);
+}
+
+
+void task_group_spawn(struct task_group *group, void (*func)(void *data), void *data)
+{
+    if (group->pool == NULL) {
+        func(data);
+        return;
+    }
+
+    struct func_task *ft = malloc(sizeof(struct func_task));
+    if (ft == NULL) {
+        func(data);
+        return;
+    }
+
+    ft->task.run = run_func_task;
+    ft->func = func;
+    ft->data = data;
+
+    if (!spawn_task(group, &ft->task)) {
+        free(ft);
+        func(data);
+    }
+}
+
+
+void task_group_wait(struct task_group *group)
+{
+    struct threadpool *pool = group->pool;
+    if (pool == NULL) {
+        return;
+    }
+
+    struct worker *self = worker_self(pool);
+    unsigned idle = 0;
+
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0) {
+        struct task *task = find_task(pool, self);
+
+        if (task != NULL) {
+            run_task(pool, task);
+            idle = 0;
+        } else if (++idle < IDLE_SPINS) {
+            sched_yield();
+        } else {
+            sleep_until_work(pool, group);
+            idle = 0;
+        }
+    }
+}
+
+
+/*
+ * Run a chunk of indexes, splitting off the upper half
+ * as a new task until the chunk is small enough.
+ */
+static void run_range(struct task_group *group, struct range_task *range)
+{
+    uint64_t begin = range->begin;
+    uint64_t end = range->end;
+
+    while (end - begin > range->grain) {
+        uint64_t mid = begin + (end - begin) / 2;
+
+        struct range_task *upper = malloc(sizeof(struct range_task));
+        if (upper == NULL) {
+            break;
+        }
+
+        *upper = *range;
+        upper->begin = mid;
+        upper->end = end;
+
+        if (!spawn_task(group, &upper->task)) {
+            free(upper);
+            break;
+        }
+
+        end = mid;
+    }
+
+    for (uint64_t idx = begin; idx < end; ++idx) {
+        range->func(range->data, idx);
+    }
+}
+
+
+static void run_range_task(struct task *task)
+{
+    run_range(task->group, (struct range_task*) task);
+}
+
+
+void threadpool_parallel_for(struct threadpool *pool, uint64_t n, uint64_t grain,
+                             void (*func)(void *data, uint64_t idx), void *data)
+{
+    if (pool == NULL || pool->nworkers <= 1 || n <= 1) {
+        for (uint64_t idx = 0; idx < n; ++idx) {
+            func(data, idx);
+        }
+        return;
+    }
+
+    if (grain == 0) {
+        grain = n / (8 * (uint64_t) pool->nworkers);
+        if (grain == 0) {
+            grain = 1;
+        }
+    }
+
+    struct task_group group;
+    task_group_init(&group, pool);
+
+    struct range_task range = {
+        .task = { .run = run_range_task, .group = &group },
+        .func = func,
+        .data = data,
+        .begin = 0,
+        .end = n,
+        .grain = grain
+    };
+
+    run_range(&group, &range);
+    task_group_wait(&group);
+}
@@ -0,0 +1,240 @@
+#include "archives.h"
+#include "archive.h"
+#include "mfile.h"
+#include "objectfile.h"
+#include "logging.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+
+
+#define NMEMBERS 16
+#define NSYMBOLS 20000
+
+
+static uint8_t data[4096];
+
+
+static struct mfile file = {
+    .name = "test.a",
+    .refcnt = 1,
+    .fd = -1,
+    .size = sizeof(data),
+    .mtime = 1234,
+    .data = data
+};
+
+
+static struct archive * create_archive(const char *name)
+{
+    struct archive *ar = archive_alloc(&file, name, NULL, 0);
+    assert(ar != NULL);
+
+    for (size_t i = 0; i < NMEMBERS; ++i) {
+        assert(archive_add_member(ar, i * 128, i * 128, 128) != NULL);
+    }
+
+    return ar;
+}
+
+
+static void symbol_name(char *buf, size_t len, uint64_t i)
+{
+    snprintf(buf, len, "_ZN4test6symbolILm%lluEE4funcEv", (unsigned long long) i);
+}
+
+
+static void check_lookups(const struct archives *index, struct archive *ar)
+{
+    char name[64];
+
+    for (uint64_t i = 0; i < NSYMBOLS; ++i) {
+        symbol_name(name, sizeof(name), i);
+        struct archive_member *m = archives_find_symbol(index, name);
+        assert(m != NULL);
+        assert(m->archive == ar);
+        assert(m == &ar->members[i % NMEMBERS]);
+    }
+
+    for (uint64_t i = NSYMBOLS; i < 2 * NSYMBOLS; ++i) {
+        symbol_name(name, sizeof(name), i);
+        assert(archives_find_symbol(index, name) == NULL);
+    }
+}
+
+
+static void test_freeze(void)
+{
+    struct archives index = {0};
+    struct archive *ar = create_archive("first.a");
+    struct archive *other = create_archive("second.a");
+    char name[64];
+
+    for (uint64_t i = 0; i < NSYMBOLS; ++i) {
+        symbol_name(name, sizeof(name), i);
+        assert(archives_insert_symbol(&index, &ar->members[i % NMEMBERS], name));
+    }
+
+    // First archive to provide a symbol wins
+    symbol_name(name, sizeof(name), 0);
+    assert(archives_insert_symbol(&index, &other->members[1], name));
+    assert(index.entries == NSYMBOLS);
+
+    check_lookups(&index, ar);
+
+    assert(archives_freeze(&index));
+    assert(archives_is_frozen(&index));
+    check_lookups(&index, ar);
+
+    // Inserting an existing symbol keeps the index frozen
+    assert(archives_insert_symbol(&index, &other->members[1], name));
+    assert(archives_is_frozen(&index));
+
+    // Inserting a new symbol thaws the index
+    assert(archives_insert_symbol(&index, &other->members[2], "new_symbol"));
+    assert(!archives_is_frozen(&index));
+    assert(archives_find_symbol(&index, "new_symbol") == &other->members[2]);
+    check_lookups(&index, ar);
+
+    archives_clear_symbols(&index);
+    archive_put(other);
+    archive_put(ar);
+}
+
+
+static void test_merge(void)
+{
+    struct archives index = {0};
+    struct archives first = {0};
+    struct archives second = {0};
+    struct archive *ar = create_archive("first.a");
+    struct archive *other = create_archive("second.a");
+    char name[64];
+
+    for (uint64_t i = 0; i < NSYMBOLS; ++i) {
+        symbol_name(name, sizeof(name), i);
+        assert(archives_insert_symbol(&first, &ar->members[i % NMEMBERS], name));
+        assert(archives_insert_symbol(&second, &other->members[i % NMEMBERS], name));
+    }
+    assert(archives_insert_symbol(&second, &other->members[0], "only_second"));
+
+    // Merging in order keeps the symbols of the first archive
+    assert(archives_merge(&index, &first));
+    assert(archives_merge(&index, &second));
+    assert(index.entries == NSYMBOLS + 1);
+    assert(archives_find_symbol(&index, "only_second") == &other->members[0]);
+    check_lookups(&index, ar);
+
+    archives_clear_symbols(&second);
+    archives_clear_symbols(&first);
+    archives_clear_symbols(&index);
+    archive_put(other);
+    archive_put(ar);
+}
+
+
+static void test_save_load(void)
+{
+    struct archives index = {0};
+    struct archive *ar = create_archive("cached.a");
+    char name[64];
+    char path[] = "/tmp/test_archives_XXXXXX";
+
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    for (uint64_t i = 0; i < NSYMBOLS; ++i) {
+        symbol_name(name, sizeof(name), i);
+        assert(archives_insert_symbol(&index, &ar->members[i % NMEMBERS], name));
+    }
+    assert(archives_freeze(&index));
+    assert(archives_save_frozen(&index, path));
+    archives_clear_symbols(&index);
+
+    struct mfile *image = NULL;
+    assert(mfile_open_read(&image, path) == 0);
+
+    struct archives loaded = {0};
+    assert(archives_load_frozen(&loaded, &ar, 1, image->data, image->size));
+    assert(loaded.entries == NSYMBOLS);
+    check_lookups(&loaded, ar);
+    archives_clear_symbols(&loaded);
+
+    // Image is stale if the archive has changed
+    file.mtime++;
+    assert(!archives_load_frozen(&loaded, &ar, 1, image->data, image->size));
+    assert(loaded.entries == 0);
+    file.mtime--;
+
+    // Truncated images are rejected
+    assert(!archives_load_frozen(&loaded, &ar, 1, image->data, image->size - 1));
+
+    mfile_put(image);
+    unlink(path);
+    archive_put(ar);
+}
+
+
+/*
+ * Releasing the content of an extracted member drops its pages from 
+ * the process, even if they stay in the page cache.
+ */
+static void test_release_member(void)
+{
+    const size_t small = 4096;
+    const size_t large = 4 << 20;
+    char path[] = "/tmp/test_archives_XXXXXX";
+
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    for (size_t n = 0; n < small + large; n += sizeof(data)) {
+        assert(write(fd, data, sizeof(data)) == (ssize_t) sizeof(data));
+    }
+    close(fd);
+
+    struct mfile *image = NULL;
+    assert(mfile_open_read(&image, path) == 0);
+
+    struct archive *ar = archive_alloc(image, path, NULL, 0);
+    assert(ar != NULL);
+    assert(archive_add_member(ar, 0, 0, small) != NULL);
+    assert(archive_add_member(ar, small, small, large) != NULL);
+
+    struct objectfile *member = archive_extract_member(archive_get_member(ar, small));
+    assert(member != NULL);
+
+    // Touch every page, so that they are resident
+    volatile uint8_t sum = 0;
+    for (size_t i = 0; i < member->file_size; i += 4096) {
+        sum += member->file_data[i];
+    }
+    (void) sum;
+
+    uint64_t mapped, before, after, cached;
+    mfile_residency(&mapped, &before, &cached);
+    assert(mapped >= small + large);
+    assert(before >= large);
+
+    objectfile_release_content(member);
+    mfile_residency(&mapped, &after, &cached);
+    assert(after + large <= before);
+
+    objectfile_put(member);
+    archive_put(ar);
+    mfile_put(image);
+    unlink(path);
+}
+
+
+int main(void)
+{
+    test_freeze();
+    test_merge();
+    test_save_load();
+    test_release_member();
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include "linker.h"
+#include "target.h"
+#include "section.h"
+#include "sections.h"
+#include "symbol.h"
+#include "symbols.h"
+#include "globals.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#define TEST_MARCH 0xbf1d
+#define NSECTIONS 20000
+#define NROOTS 8
+
+
+static int apply_reloc(uint8_t *content, uint64_t offset, uint64_t baseaddr,
+                       uint64_t targetaddr, int64_t addend, uint32_t type)
+{
+    (void) content; (void) offset; (void) baseaddr;
+    (void) targetaddr; (void) addend; (void) type;
+    return 0;
+}
+
+
+static const struct target test_target = {
+    .name = "test",
+    .section_boundary = 4096,
+    .cpu_code_alignment = 16,
+    .min_page_size = 4096,
+    .max_page_size = 4096,
+    .apply_reloc = apply_reloc
+};
+
+
+static uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+
+/*
+ * Create sections with two global symbols each, and relocations to random 
+ * symbols. The second symbol in every section is never referenced. Some 
+ * sections have many relocations and some have none, so that parts of 
+ * the graph are unreachable from the roots.
+ */
+static void create_graph(struct linkerctx *ctx, struct section **sects, struct symbol **syms, struct symbols *roots)
+{
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    char name[32];
+
+    for (uint64_t i = 0; i < NSECTIONS; ++i) {
+        snprintf(name, sizeof(name), ".text.f%llu", (unsigned long long) i);
+        sects[i] = section_alloc(ctx, name, SECTION_CODE, 16);
+        assert(sects[i] != NULL);
+        assert(sections_push(&ctx->sections, sects[i]));
+
+        syms[i] = symbol_alloc(ctx, name + 6, SYMBOL_FUNCTION, SYMBOL_GLOBAL);
+        assert(syms[i] != NULL);
+        assert(symbol_define(syms[i], sects[i], 0, 16));
+        assert(globals_insert_symbol(&ctx->globals, syms[i], NULL) == 0);
+        symbol_put(syms[i]);
+
+        snprintf(name, sizeof(name), "g%llu", (unsigned long long) i);
+        struct symbol *alias = symbol_alloc(ctx, name, SYMBOL_FUNCTION, SYMBOL_GLOBAL);
+        assert(alias != NULL);
+        assert(symbol_define(alias, sects[i], 8, 8));
+        assert(globals_insert_symbol(&ctx->globals, alias, NULL) == 0);
+        symbol_put(alias);
+        section_put(sects[i]);
+    }
+
+    for (uint64_t i = 0; i < NSECTIONS; ++i) {
+        uint64_t r = next_random(&state);
+        uint64_t nrelocs = r % 4 == 0 ? 0 : (r >> 8) % (r % 97 == 0 ? 200 : 4);
+
+        for (uint64_t j = 0; j < nrelocs; ++j) {
+            struct symbol *target = syms[next_random(&state) % NSECTIONS];
+            assert(section_add_reloc(sects[i], j * 4, target, 0, 0, 0) != NULL);
+        }
+    }
+
+    for (uint64_t i = 0; i < NROOTS; ++i) {
+        symbols_push(roots, syms[next_random(&state) % NSECTIONS]);
+    }
+}
+
+
+/*
+ * Run the mark phase and record which sections (first half of alive) 
+ * and symbols (second half) were marked alive.
+ */
+static uint64_t mark(struct linkerctx *ctx, struct section **sects, struct symbol **syms, 
+                     const struct symbols *roots, bool *alive)
+{
+    uint64_t nalive = 0;
+
+    for (uint64_t i = 0; i < NSECTIONS; ++i) {
+        sects[i]->is_alive = false;
+        syms[i]->is_used = false;
+    }
+
+    linker_dce_mark(ctx, roots);
+
+    for (uint64_t i = 0; i < NSECTIONS; ++i) {
+        alive[i] = sects[i]->is_alive;
+        alive[NSECTIONS + i] = symbol_is_alive(syms[i]);
+        nalive += alive[i];
+    }
+
+    return nalive;
+}
+
+
+void test_parallel_mark_matches_serial()
+{
+    struct linkerctx *ctx = linker_alloc("a.out", TEST_MARCH);
+    assert(ctx != NULL);
+
+    struct section **sects = calloc(NSECTIONS, sizeof(struct section*));
+    struct symbol **syms = calloc(NSECTIONS, sizeof(struct symbol*));
+    bool *serial = calloc(2 * NSECTIONS, sizeof(bool));
+    bool *parallel = calloc(2 * NSECTIONS, sizeof(bool));
+    struct symbols roots = {0};
+    assert(sects != NULL && syms != NULL && serial != NULL && parallel != NULL);
+
+    create_graph(ctx, sects, syms, &roots);
+
+    ctx->threads = 1;
+    uint64_t nserial = mark(ctx, sects, syms, &roots, serial);
+    assert(nserial > 0 && nserial < NSECTIONS);
+
+    // The thread pool is created on first use, with ctx->threads workers
+    ctx->threads = 4;
+    for (int run = 0; run < 10; ++run) {
+        uint64_t nparallel = mark(ctx, sects, syms, &roots, parallel);
+        assert(nparallel == nserial);
+        assert(memcmp(serial, parallel, 2 * NSECTIONS * sizeof(bool)) == 0);
+    }
+
+    // A symbol is used if it is a root or referenced from a live section,
+    // so the unreferenced second symbols are unused even in live sections
+    uint64_t nused = 0;
+    for (uint64_t i = 0; i < NSECTIONS; ++i) {
+        assert(!serial[NSECTIONS + i] || serial[i]);
+        nused += serial[NSECTIONS + i];
+    }
+    assert(ctx->globals.nglobals == 2 * NSECTIONS);
+
+    // The sweep is sharded across threads, and live sections keep their order
+    linker_dce_sweep(ctx);
+    assert(sections_size(&ctx->sections) == nserial);
+
+    uint64_t pos = 0;
+    for (uint64_t i = 0; i < NSECTIONS; ++i) {
+        if (serial[i]) {
+            assert(sections_at(&ctx->sections, pos++) == sects[i]);
+        }
+    }
+    assert(ctx->globals.nglobals == nused);
+
+    char name[32];
+    for (uint64_t i = 0; i < NSECTIONS; ++i) {
+        snprintf(name, sizeof(name), "f%llu", (unsigned long long) i);
+        struct symbol *sym = globals_find_symbol(&ctx->globals, name);
+        assert(serial[NSECTIONS + i] ? sym == syms[i] : sym == NULL);
+
+        snprintf(name, sizeof(name), "g%llu", (unsigned long long) i);
+        assert(globals_find_symbol(&ctx->globals, name) == NULL);
+    }
+
+    symbols_clear(&roots);
+    linker_put(ctx);
+
+    free(sects);
+    free(syms);
+    free(serial);
+    free(parallel);
+}
+
+
+int main()
+{
+    target_register(&test_target, TEST_MARCH);
+    test_parallel_mark_matches_serial();
+    return 0;
+}
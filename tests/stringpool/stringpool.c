@@ -48,6 +48,56 @@ void test_tail_merge(void)
 }
 
 
+void test_pack_large(void)
+{
+    struct strpool pool = {0};
+    size_t size = 1;
+    char *strtab = malloc(20000 * 32);
+    assert(strtab != NULL);
+
+    // The string table is larger than what the pool grows to by doubling
+    strtab[0] = '\0';
+    for (int i = 0; i < 20000; ++i) {
+        size += snprintf(strtab + size, 32, "symbol_%d", i) + 1;
+    }
+
+    assert(strpool_pack(&pool, strtab, size) == 20001);
+    assert(strcmp(strpool_at(&pool, strpool_lookup(&pool, "symbol_19999")), "symbol_19999") == 0);
+
+    strpool_clear(&pool);
+    free(strtab);
+}
+
+
+void test_table_stats(void)
+{
+    struct strpool pool = {0};
+    struct table_stats stats;
+    char name[32];
+
+    for (int i = 0; i < 1000; ++i) {
+        snprintf(name, sizeof(name), "symbol_%d", i);
+        strpool_intern(&pool, name);
+    }
+
+    for (int i = 0; i < 2000; ++i) {
+        snprintf(name, sizeof(name), "symbol_%d", i);
+        strpool_lookup(&pool, name);
+    }
+
+    strpool_table_stats(&pool, &stats);
+    assert(stats.capacity == pool.capacity);
+    assert(stats.entries == pool.count);
+    assert(stats.rehashes > 0);
+    assert(stats.hits == 1000);
+    assert(stats.misses == 999 + 1000);
+    assert(stats.probes >= stats.hits + stats.misses);
+    assert(stats.total_dfi <= stats.max_dfi * stats.entries);
+
+    strpool_clear(&pool);
+}
+
+
 int main(int argc, char **argv)
 {
     log_level = 9;
@@ -88,6 +138,8 @@ int main(int argc, char **argv)
     assert(pool.capacity == 0);
 
     test_tail_merge();
+    test_table_stats();
+    test_pack_large();
     
     return 0;
 }
@@ -0,0 +1,174 @@
+#include <cdeque.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+
+#define ENTRY(i) ((void*) (uintptr_t) ((i) + 1))
+#define INDEX(e) ((uint64_t) (uintptr_t) (e) - 1)
+
+
+void test_empty()
+{
+    struct cdeque d = CDEQUE_INIT;
+
+    assert(cdeque_empty(&d));
+    assert(cdeque_pop_back(&d) == NULL);
+    assert(cdeque_pop_front(&d) == NULL);
+    assert(cdeque_size(&d) == 0);
+
+    cdeque_clear(&d);
+}
+
+
+void test_lifo_fifo()
+{
+    struct cdeque d = CDEQUE_INIT;
+
+    for (uint64_t i = 0; i < 100; ++i) {
+        assert(cdeque_push_back(&d, ENTRY(i)));
+    }
+    assert(cdeque_size(&d) == 100);
+
+    // Back is LIFO, front is FIFO
+    assert(INDEX(cdeque_pop_back(&d)) == 99);
+    assert(INDEX(cdeque_pop_front(&d)) == 0);
+    assert(INDEX(cdeque_pop_front(&d)) == 1);
+    assert(INDEX(cdeque_pop_back(&d)) == 98);
+    assert(cdeque_size(&d) == 96);
+
+    for (uint64_t i = 2; i < 98; ++i) {
+        assert(INDEX(cdeque_pop_front(&d)) == i);
+    }
+    assert(cdeque_pop_back(&d) == NULL);
+    assert(cdeque_empty(&d));
+
+    cdeque_clear(&d);
+}
+
+
+void test_grow_wrapped()
+{
+    struct cdeque d = CDEQUE_INIT;
+
+    assert(cdeque_reserve(&d, 8));
+
+    // Move top and bottom past the end of the buffer before it grows
+    for (uint64_t i = 0; i < 6; ++i) {
+        cdeque_push_back(&d, ENTRY(i));
+    }
+    for (uint64_t i = 0; i < 4; ++i) {
+        assert(INDEX(cdeque_pop_front(&d)) == i);
+    }
+    for (uint64_t i = 6; i < 40; ++i) {
+        cdeque_push_back(&d, ENTRY(i));
+    }
+
+    for (uint64_t i = 4; i < 40; ++i) {
+        assert(INDEX(cdeque_pop_front(&d)) == i);
+    }
+    assert(cdeque_empty(&d));
+
+    cdeque_clear(&d);
+}
+
+
+/*
+ * Stress test: the owner pushes entries (and pops some of them back)
+ * while thieves pop from the front. Every entry must be popped exactly once.
+ */
+struct stress
+{
+    struct cdeque deque;
+    uint64_t n;
+    uint32_t *seen;
+    bool done;
+};
+
+
+static void consume(struct stress *s, void *entry)
+{
+    uint64_t idx = INDEX(entry);
+    assert(idx < s->n);
+    uint32_t count = __atomic_add_fetch(&s->seen[idx], 1, __ATOMIC_RELAXED);
+    assert(count == 1);
+    (void) count;
+}
+
+
+static void * thief(void *arg)
+{
+    struct stress *s = arg;
+
+    while (true) {
+        void *entry = cdeque_pop_front(&s->deque);
+        if (entry != NULL) {
+            consume(s, entry);
+        } else if (__atomic_load_n(&s->done, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+
+void test_stress(int nthieves, uint64_t n)
+{
+    struct stress s = {
+        .deque = CDEQUE_INIT,
+        .n = n,
+        .seen = calloc(n, sizeof(uint32_t)),
+        .done = false
+    };
+    assert(s.seen != NULL);
+
+    pthread_t threads[nthieves];
+    for (int i = 0; i < nthieves; ++i) {
+        assert(pthread_create(&threads[i], NULL, thief, &s) == 0);
+    }
+
+    for (uint64_t i = 0; i < n; ++i) {
+        assert(cdeque_push_back(&s.deque, ENTRY(i)));
+
+        // Pop every third entry back, to race with thieves on the last entry
+        if (i % 3 == 0) {
+            void *entry = cdeque_pop_back(&s.deque);
+            if (entry != NULL) {
+                consume(&s, entry);
+            }
+        }
+    }
+
+    void *entry;
+    while ((entry = cdeque_pop_back(&s.deque)) != NULL) {
+        consume(&s, entry);
+    }
+
+    __atomic_store_n(&s.done, true, __ATOMIC_RELEASE);
+    for (int i = 0; i < nthieves; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (uint64_t i = 0; i < n; ++i) {
+        assert(s.seen[i] == 1);
+    }
+
+    free(s.seen);
+    cdeque_clear(&s.deque);
+}
+
+
+int main()
+{
+    test_empty();
+    test_lifo_fifo();
+    test_grow_wrapped();
+    test_stress(1, 10000);
+    test_stress(4, 100000);
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include <threadpool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+
+
+static void count_index(void *data, uint64_t idx)
+{
+    uint32_t *counts = data;
+    __atomic_add_fetch(&counts[idx], 1, __ATOMIC_RELAXED);
+}
+
+
+void test_parallel_for(unsigned nthreads, uint64_t n, uint64_t grain)
+{
+    struct threadpool *pool = threadpool_alloc(nthreads);
+    assert(pool != NULL);
+
+    uint32_t *counts = calloc(n, sizeof(uint32_t));
+    assert(counts != NULL);
+
+    threadpool_parallel_for(pool, n, grain, count_index, counts);
+
+    for (uint64_t i = 0; i < n; ++i) {
+        assert(counts[i] == 1);
+    }
+
+    free(counts);
+    threadpool_free(pool);
+}
+
+
+void test_no_pool()
+{
+    uint32_t counts[100] = {0};
+
+    threadpool_parallel_for(NULL, 100, 0, count_index, counts);
+
+    for (int i = 0; i < 100; ++i) {
+        assert(counts[i] == 1);
+    }
+
+    assert(threadpool_size(NULL) == 1);
+    assert(threadpool_worker_index(NULL) == 0);
+}
+
+
+static void increment(void *data)
+{
+    __atomic_add_fetch((uint64_t*) data, 1, __ATOMIC_RELAXED);
+}
+
+
+void test_many_spawns()
+{
+    struct threadpool *pool = threadpool_alloc(4);
+    assert(pool != NULL);
+
+    uint64_t counter = 0;
+    struct task_group group;
+    task_group_init(&group, pool);
+
+    // More tasks than fit in the initial deque, so that it grows
+    // while other workers are stealing from it
+    for (int i = 0; i < 10000; ++i) {
+        task_group_spawn(&group, increment, &counter);
+    }
+    task_group_wait(&group);
+
+    assert(counter == 10000);
+    threadpool_free(pool);
+}
+
+
+struct fib
+{
+    struct threadpool *pool;
+    uint64_t n;
+    uint64_t result;
+};
+
+
+static void fib_task(void *data)
+{
+    struct fib *f = data;
+
+    if (f->n < 2) {
+        f->result = f->n;
+        return;
+    }
+
+    struct fib a = { .pool = f->pool, .n = f->n - 1 };
+    struct fib b = { .pool = f->pool, .n = f->n - 2 };
+
+    struct task_group group;
+    task_group_init(&group, f->pool);
+    task_group_spawn(&group, fib_task, &a);
+    fib_task(&b);
+    task_group_wait(&group);
+
+    f->result = a.result + b.result;
+}
+
+
+void test_nested_groups()
+{
+    struct threadpool *pool = threadpool_alloc(4);
+    assert(pool != NULL);
+
+    struct fib f = { .pool = pool, .n = 20 };
+    fib_task(&f);
+    assert(f.result == 6765);
+
+    threadpool_free(pool);
+}
+
+
+struct index_check
+{
+    const struct threadpool *pool;
+    unsigned *seen;
+};
+
+
+static void check_worker_index(void *data, uint64_t idx)
+{
+    struct index_check *check = data;
+    unsigned w = threadpool_worker_index(check->pool);
+    assert(w < threadpool_size(check->pool));
+    check->seen[idx] = w;
+}
+
+
+void test_worker_index()
+{
+    struct threadpool *pool = threadpool_alloc(3);
+    assert(pool != NULL);
+    assert(threadpool_size(pool) == 3);
+    assert(threadpool_worker_index(pool) == 0);
+
+    unsigned seen[1000];
+    struct index_check check = { .pool = pool, .seen = seen };
+    threadpool_parallel_for(pool, 1000, 1, check_worker_index, &check);
+
+    threadpool_free(pool);
+}
+
+
+void test_sleep_and_wake()
+{
+    struct threadpool *pool = threadpool_alloc(4);
+    assert(pool != NULL);
+
+    // Let workers go to sleep between rounds
+    for (int round = 0; round < 5; ++round) {
+        uint32_t counts[64] = {0};
+        usleep(2000);
+        threadpool_parallel_for(pool, 64, 1, count_index, counts);
+        for (int i = 0; i < 64; ++i) {
+            assert(counts[i] == 1);
+        }
+    }
+
+    threadpool_free(pool);
+}
+
+
+void test_default_threads()
+{
+    setenv("BFLD_THREADS", "3", 1);
+    assert(threadpool_default_threads() == 3);
+
+    struct threadpool *pool = threadpool_alloc(0);
+    assert(pool != NULL);
+    assert(threadpool_size(pool) == 3);
+    threadpool_free(pool);
+
+    setenv("BFLD_THREADS", "bogus", 1);
+    assert(threadpool_default_threads() >= 1);
+    unsetenv("BFLD_THREADS");
+}
+
+
+int main()
+{
+    test_no_pool();
+    test_parallel_for(1, 1000, 0);
+    test_parallel_for(2, 1, 0);
+    test_parallel_for(4, 100000, 0);
+    test_parallel_for(8, 10000, 1);
+    test_many_spawns();
+    test_nested_groups();
+    test_worker_index();
+    test_sleep_and_wake();
+    test_default_threads();
+    return 0;
+}